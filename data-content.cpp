@@ -27,30 +27,23 @@
 
 namespace chronosync {
 
-void
-pD(ndn::ConstBufferPtr digest, std::string name)
+DataContent::DataContent(const Name& userPrefix,
+		         RoundNo roundNo,
+		         DiffStatePtr statePtr)
+  :m_userPrefix (userPrefix)
+  ,m_roundNo (roundNo)
+  ,m_hasCumulativeDigest (false)
+  ,m_statePtr (statePtr)
 {
-  using namespace CryptoPP;
-
-  if (digest){
-    std::string hash;
-    StringSource(digest->buf(), digest->size(), true,
-                 new HexEncoder(new StringSink(hash), false));    
-    std::cerr << "  " << name << ": " << hash << std::endl;
-  }
-  else
-    std::cerr << "  " << name << ": " << "NULL" << std::endl;
 }
 
-
-
-
-DataContent::DataContent(const Name& userPrefix,   
+DataContent::DataContent(const Name& userPrefix,
 		         RoundNo roundNo,
-		         ndn::ConstBufferPtr cumulativeDigest,
+		         const Digest& cumulativeDigest,
 		         DiffStatePtr statePtr)
   :m_userPrefix (userPrefix)
   ,m_roundNo (roundNo)
+  ,m_hasCumulativeDigest (true)
   ,m_cumulativeDigest (cumulativeDigest)
   ,m_statePtr (statePtr)
 {
@@ -74,10 +67,10 @@ DataContent::wireEncode(ndn::EncodingImpl<T>& block) const
   }
 
   // encode prefix|roundNo|cumulativeDigest if they exist
-  if (m_cumulativeDigest){
+  if (m_hasCumulativeDigest){
     size_t length = 0;
     // encode cumulative digest
-    length +=  ndn::name::Component(m_cumulativeDigest).wireEncode(block);
+    length +=  m_cumulativeDigest.toComponent().wireEncode(block);
     
     // encode roundNo
     length += prependNonNegativeIntegerBlock(block, tlv::RoundNo, m_roundNo);
@@ -95,12 +88,12 @@ DataContent::wireEncode(ndn::EncodingImpl<T>& block) const
   totalLength += block.prependVarNumber(totalLength);
 
   tlv::DataType kind = tlv::DataAndCumulative;
-  if (!(m_statePtr && m_cumulativeDigest)) {
+  if (!(m_statePtr && m_hasCumulativeDigest)) {
     if (m_statePtr) {
       kind = tlv::DataOnly;
     }
     else 
-      if (m_cumulativeDigest)
+      if (m_hasCumulativeDigest)
 	kind = tlv::CumulativeOnly;
   }
   
@@ -168,9 +161,12 @@ DataContent::wireDecode(const Block& wire)
     
     // Decode cumulative digest
     name::Component cd (*it1);
-    m_cumulativeDigest =
-      make_shared<ndn::Buffer>(cd.value(), 
-                               cd.value_size());
+    if (cd.value_size() != Digest::SIZE)
+      throw Error("Unexpected cumulative digest size when decoding DataContent: " +
+                  boost::lexical_cast<std::string>(cd.value_size()));
+
+    m_cumulativeDigest = Digest(cd.value(), cd.value_size());
+    m_hasCumulativeDigest = true;
     
     it++;
   }
@@ -187,8 +183,8 @@ DataContent::wireDecode(const Block& wire)
 bool 
 DataContent::wellFormed()
   {
-    return ((m_userPrefix != Name("") && m_cumulativeDigest != NULL) ||  
-	    (m_roundNo == 0 && m_cumulativeDigest == NULL && m_statePtr != NULL));
+    return ((m_userPrefix != Name("") && m_hasCumulativeDigest) ||
+	    (m_roundNo == 0 && !m_hasCumulativeDigest && m_statePtr != NULL));
   }
 
 
@@ -46,9 +46,19 @@ public:
   };
 
 
-  DataContent(const Name& userPrefix = Name(""),  
+  /**
+   * @brief Create a DataContent without cumulative digest
+   */
+  DataContent(const Name& userPrefix = Name(""),
               RoundNo roundNo = 0,
-              ndn::ConstBufferPtr cumulativeDigest = NULL,
+              DiffStatePtr statePtr = NULL);
+
+  /**
+   * @brief Create a DataContent carrying the cumulative digest of @p roundNo
+   */
+  DataContent(const Name& userPrefix,
+              RoundNo roundNo,
+              const Digest& cumulativeDigest,
               DiffStatePtr statePtr = NULL);
 
   StatePtr 
@@ -61,7 +71,12 @@ getRoundNo(){
   return m_roundNo;
 }
 
-ndn::ConstBufferPtr 
+bool
+hasCumulativeDigest(){
+  return m_hasCumulativeDigest;
+}
+
+const Digest&
 getCumulativeDigest(){
   return m_cumulativeDigest;
 }
@@ -108,7 +123,8 @@ protected:
 private:
   ndn::Name m_userPrefix;
   RoundNo m_roundNo; // The round of m_cumulativeDigest
-  ndn::ConstBufferPtr m_cumulativeDigest; // The cumulative digest of m_round
+  bool m_hasCumulativeDigest;
+  Digest m_cumulativeDigest; // The cumulative digest of m_round
   DiffStatePtr m_statePtr;
   tlv::DataType m_dataType;
 };
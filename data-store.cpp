@@ -0,0 +1,167 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "data-store.hpp"
+
+namespace chronosync {
+
+DataStore::~DataStore()
+{
+}
+
+MemoryDataStore::MemoryDataStore(size_t maxPackets,
+                                 size_t maxBytes,
+                                 const time::milliseconds& maxAge,
+                                 size_t sessionWindow)
+  : m_maxPackets(maxPackets)
+  , m_maxBytes(maxBytes)
+  , m_maxAge(maxAge)
+  , m_sessionWindow(sessionWindow)
+  , m_nextInsertSeq(0)
+{
+}
+
+void
+MemoryDataStore::insert(const Data& data)
+{
+  evictExpired();
+
+  const Name& name = data.getName();
+  EntryMap::iterator it = m_entries.find(name);
+  if (it != m_entries.end())
+    remove(it, false);
+
+  Entry entry;
+  entry.data = data.shared_from_this();
+  entry.size = data.wireEncode().size();
+  entry.insertSeq = m_nextInsertSeq++;
+  m_lru.push_front(name);
+  entry.lruIt = m_lru.begin();
+  m_entries[name] = entry;
+
+  if (m_maxAge > time::milliseconds::zero()) {
+    Insertion insertion = {time::steady_clock::now(), entry.insertSeq, name};
+    m_insertions.push_back(insertion);
+  }
+
+  m_stats.nPackets++;
+  m_stats.nBytes += entry.size;
+  m_stats.nInserted++;
+
+  if (!name.empty()) {
+    Name session = name.getPrefix(-1);
+    m_sessionSizes[session]++;
+    evictSession(session);
+  }
+  evictOverCapacity();
+}
+
+shared_ptr<const Data>
+MemoryDataStore::find(const Interest& interest)
+{
+  evictExpired();
+
+  const Name& name = interest.getName();
+  for (EntryMap::iterator it = m_entries.lower_bound(name);
+       it != m_entries.end() && name.isPrefixOf(it->first); ++it) {
+    if (interest.matchesData(*it->second.data)) {
+      m_lru.splice(m_lru.begin(), m_lru, it->second.lruIt);
+      m_stats.nHits++;
+      return it->second.data;
+    }
+  }
+
+  m_stats.nMisses++;
+  return shared_ptr<const Data>();
+}
+
+void
+MemoryDataStore::erase(const Name& prefix)
+{
+  EntryMap::iterator it = m_entries.lower_bound(prefix);
+  while (it != m_entries.end() && prefix.isPrefixOf(it->first))
+    remove(it++, false);
+}
+
+void
+MemoryDataStore::remove(EntryMap::iterator it, bool isEvicted)
+{
+  const Name& name = it->first;
+  if (!name.empty()) {
+    std::map<Name, size_t>::iterator session = m_sessionSizes.find(name.getPrefix(-1));
+    if (session != m_sessionSizes.end() && --session->second == 0)
+      m_sessionSizes.erase(session);
+  }
+
+  m_stats.nPackets--;
+  m_stats.nBytes -= it->second.size;
+  if (isEvicted)
+    m_stats.nEvicted++;
+
+  m_lru.erase(it->second.lruIt);
+  m_entries.erase(it);
+}
+
+void
+MemoryDataStore::evictExpired()
+{
+  if (m_insertions.empty())
+    return;
+
+  time::steady_clock::time_point now = time::steady_clock::now();
+  while (!m_insertions.empty() && m_insertions.front().time + m_maxAge <= now) {
+    // The packet may have been removed, or replaced by a newer one
+    EntryMap::iterator it = m_entries.find(m_insertions.front().name);
+    if (it != m_entries.end() && it->second.insertSeq == m_insertions.front().seq)
+      remove(it, true);
+    m_insertions.pop_front();
+  }
+}
+
+void
+MemoryDataStore::evictSession(const Name& session)
+{
+  if (m_sessionWindow == 0)
+    return;
+
+  // SeqNo components sort in numerical order, so the first packet of the
+  // session has the lowest seqNo
+  std::map<Name, size_t>::iterator size = m_sessionSizes.find(session);
+  while (size != m_sessionSizes.end() && size->second > m_sessionWindow) {
+    EntryMap::iterator it = m_entries.lower_bound(session);
+    while (it->first.size() != session.size() + 1)
+      ++it;
+    remove(it, true);
+  }
+}
+
+void
+MemoryDataStore::evictOverCapacity()
+{
+  while (!m_lru.empty() &&
+         ((m_maxPackets != 0 && m_stats.nPackets > m_maxPackets) ||
+          (m_maxBytes != 0 && m_stats.nBytes > m_maxBytes))) {
+    remove(m_entries.find(m_lru.back()), true);
+  }
+}
+
+} // namespace chronosync
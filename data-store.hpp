@@ -0,0 +1,181 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_DATA_STORE_HPP
+#define CHRONOSYNC_DATA_STORE_HPP
+
+#include "common-chronosync.hpp"
+
+#include <deque>
+#include <map>
+
+namespace chronosync {
+
+/**
+ * @brief Storage of the Data published by a Socket
+ *
+ * The packets are named <session>/<seqNo>.  A store may drop packets at any
+ * time (see MemoryDataStore); the Interests for them are then not answered.
+ */
+class DataStore : noncopyable
+{
+public:
+  /**
+   * @brief Memory usage and activity counters
+   */
+  struct Stats
+  {
+    Stats()
+      : nPackets(0)
+      , nBytes(0)
+      , nInserted(0)
+      , nEvicted(0)
+      , nHits(0)
+      , nMisses(0)
+    {
+    }
+
+    /// packets currently stored
+    size_t nPackets;
+    /// wire size of the packets currently stored
+    size_t nBytes;
+    uint64_t nInserted;
+    /// packets dropped by the store itself, not by erase()
+    uint64_t nEvicted;
+    uint64_t nHits;
+    uint64_t nMisses;
+  };
+
+  virtual
+  ~DataStore();
+
+  /**
+   * @brief Store @p data, replacing a packet with the same name
+   */
+  virtual void
+  insert(const Data& data) = 0;
+
+  /**
+   * @brief Find a packet that satisfies @p interest
+   *
+   * @return NULL if there is none
+   */
+  virtual shared_ptr<const Data>
+  find(const Interest& interest) = 0;
+
+  /**
+   * @brief Remove all the packets under @p prefix
+   */
+  virtual void
+  erase(const Name& prefix) = 0;
+
+  const Stats&
+  getStats() const
+  {
+    return m_stats;
+  }
+
+protected:
+  Stats m_stats;
+};
+
+/**
+ * @brief In memory DataStore with bounded capacity
+ *
+ * Packets are dropped, least recently used first, when the store holds
+ * more than maxPackets packets or maxBytes bytes.  They are also dropped
+ * maxAge after being inserted, and when their session has more than
+ * sessionWindow packets (the lowest seqNos go first).  A zero limit is
+ * no limit; by default the store never drops packets.
+ */
+class MemoryDataStore : public DataStore
+{
+public:
+  explicit
+  MemoryDataStore(size_t maxPackets = 0,
+                  size_t maxBytes = 0,
+                  const time::milliseconds& maxAge = time::milliseconds::zero(),
+                  size_t sessionWindow = 0);
+
+  virtual void
+  insert(const Data& data);
+
+  virtual shared_ptr<const Data>
+  find(const Interest& interest);
+
+  virtual void
+  erase(const Name& prefix);
+
+private:
+  struct Entry
+  {
+    shared_ptr<const Data> data;
+    size_t size;
+    // Tells the insertion of this packet from earlier ones with the same
+    // name, which may have the same time
+    uint64_t insertSeq;
+    std::list<Name>::iterator lruIt;
+  };
+
+  struct Insertion
+  {
+    time::steady_clock::time_point time;
+    uint64_t seq;
+    Name name;
+  };
+
+  typedef std::map<Name, Entry> EntryMap;
+
+  void
+  remove(EntryMap::iterator it, bool isEvicted);
+
+  /// @brief Drop the packets older than m_maxAge
+  void
+  evictExpired();
+
+  /// @brief Drop the lowest seqNos of @p session over m_sessionWindow
+  void
+  evictSession(const Name& session);
+
+  /// @brief Drop the least recently used packets over the capacity
+  void
+  evictOverCapacity();
+
+private:
+  size_t m_maxPackets;
+  size_t m_maxBytes;
+  time::milliseconds m_maxAge;
+  size_t m_sessionWindow;
+
+  EntryMap m_entries;
+  // Most recently used first
+  std::list<Name> m_lru;
+  // Insertions of the packets, oldest first; only with m_maxAge
+  std::deque<Insertion> m_insertions;
+  uint64_t m_nextInsertSeq;
+  // Number of packets of each session
+  std::map<Name, size_t> m_sessionSizes;
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_DATA_STORE_HPP
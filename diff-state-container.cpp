@@ -20,6 +20,176 @@
  * @author Chaoyi Bian <bcy@pku.edu.cn>
  * @author Alexander Afanasyev <http://lasr.cs.ucla.edu/afanasyev/index.html>
  * @author Yingdi Yu <yingdi@cs.ucla.edu>
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
  */
 
 #include "diff-state-container.hpp"
+
+#include <limits>
+
+namespace chronosync {
+
+// Slots of the window; a round log this long is stabilized and dropped long
+// before the window is full
+const size_t DiffStateContainer::MAX_WINDOW_SIZE(65536);
+
+DiffStateContainer::DiffStateContainer()
+  : m_base(0)
+  , m_size(0)
+{
+}
+
+DiffStateContainer::const_iterator
+DiffStateContainer::lower_bound(RoundNo round) const
+{
+  bool isFound = false;
+  RoundNo found = 0;
+
+  if (!m_slots.empty() && round < m_base + m_slots.size()) {
+    size_t offset = round <= m_base ? 0 : round - m_base;
+    while (!m_slots[offset])
+      ++offset;
+    isFound = true;
+    found = m_base + offset;
+  }
+
+  std::map<RoundNo, DiffStatePtr>::const_iterator sparse = m_sparse.lower_bound(round);
+  if (sparse != m_sparse.end() && (!isFound || sparse->first < found)) {
+    isFound = true;
+    found = sparse->first;
+  }
+
+  return const_iterator(this, found, !isFound);
+}
+
+DiffStateContainer::const_iterator
+DiffStateContainer::upper_bound(RoundNo round) const
+{
+  if (round == std::numeric_limits<RoundNo>::max())
+    return end();
+
+  return lower_bound(round + 1);
+}
+
+RoundNo
+DiffStateContainer::lastRound() const
+{
+  BOOST_ASSERT(!empty());
+
+  RoundNo last = m_slots.empty() ? 0 : m_base + m_slots.size() - 1;
+  if (!m_sparse.empty())
+    last = std::max(last, m_sparse.rbegin()->first);
+  return last;
+}
+
+RoundNo
+DiffStateContainer::previousRound(RoundNo round) const
+{
+  bool isFound = false;
+  RoundNo found = 0;
+
+  if (!m_slots.empty() && round > m_base) {
+    size_t offset = std::min<RoundNo>(round - m_base, m_slots.size());
+    do {
+      --offset;
+    } while (!m_slots[offset]);
+    isFound = true;
+    found = m_base + offset;
+  }
+
+  std::map<RoundNo, DiffStatePtr>::const_iterator sparse = m_sparse.lower_bound(round);
+  if (sparse != m_sparse.begin()) {
+    --sparse;
+    if (!isFound || sparse->first > found)
+      found = sparse->first;
+  }
+
+  return found;
+}
+
+std::pair<DiffStateContainer::const_iterator, bool>
+DiffStateContainer::insert(const DiffStatePtr& state)
+{
+  BOOST_ASSERT(static_cast<bool>(state));
+
+  RoundNo round = state->getRound();
+
+  const_iterator it = find(round);
+  if (it != end())
+    return std::make_pair(it, false);
+
+  if (m_slots.empty()) {
+    m_base = round;
+    m_slots.push_back(state);
+  }
+  else if (round >= m_base && round - m_base < MAX_WINDOW_SIZE) {
+    if (round - m_base >= m_slots.size())
+      m_slots.resize(round - m_base + 1);
+    m_slots[round - m_base] = state;
+  }
+  else if (round < m_base && m_base - round <= MAX_WINDOW_SIZE - m_slots.size()) {
+    m_slots.insert(m_slots.begin(), m_base - round, DiffStatePtr());
+    m_base = round;
+    m_slots.front() = state;
+  }
+  else
+    m_sparse[round] = state;
+
+  ++m_size;
+  return std::make_pair(const_iterator(this, round, false), true);
+}
+
+DiffStateContainer::const_iterator
+DiffStateContainer::erase(const_iterator it)
+{
+  RoundNo round = (*it)->getRound();
+
+  if (isInWindow(round)) {
+    m_slots[round - m_base].reset();
+    trim();
+  }
+  else
+    m_sparse.erase(round);
+  --m_size;
+
+  return upper_bound(round);
+}
+
+void
+DiffStateContainer::eraseBefore(RoundNo round)
+{
+  while (!m_slots.empty() && m_base < round) {
+    if (m_slots.front())
+      --m_size;
+    m_slots.pop_front();
+    ++m_base;
+  }
+  trim();
+
+  std::map<RoundNo, DiffStatePtr>::iterator last = m_sparse.lower_bound(round);
+  m_size -= std::distance(m_sparse.begin(), last);
+  m_sparse.erase(m_sparse.begin(), last);
+}
+
+void
+DiffStateContainer::clear()
+{
+  m_slots.clear();
+  m_sparse.clear();
+  m_base = 0;
+  m_size = 0;
+}
+
+void
+DiffStateContainer::trim()
+{
+  while (!m_slots.empty() && !m_slots.front()) {
+    m_slots.pop_front();
+    ++m_base;
+  }
+  while (!m_slots.empty() && !m_slots.back())
+    m_slots.pop_back();
+}
+
+} // namespace chronosync
@@ -27,48 +27,206 @@
 #ifndef CHRONOSYNC_DIFF_STATE_CONTAINER_HPP
 #define CHRONOSYNC_DIFF_STATE_CONTAINER_HPP
 
-#include "mi-tag.hpp"
 #include "diff-state.hpp"
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/tag.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/sequenced_index.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/mem_fun.hpp>
+#include <deque>
+#include <map>
+
+#include <boost/iterator/iterator_facade.hpp>
 
 namespace chronosync {
 
-namespace mi = boost::multi_index;
+/**
+ * @brief Container for differential states (the round log)
+ *
+ * Rounds are dense and grow monotonically, so the diff states are kept in a
+ * sliding window of slots indexed by (round - base round): finding a round is
+ * O(1), iteration walks contiguous slots in round order, and removing the
+ * oldest rounds is a pop from the front.  Rounds without a diff state take an
+ * empty slot, which iterators skip.
+ *
+ * Round numbers come from other nodes, so the window is bounded to
+ * MAX_WINDOW_SIZE slots: a round that would make it larger is kept in a
+ * sparse map instead, and iteration merges both in round order.
+ *
+ * Iterators refer to the round of their diff state, so they stay valid when
+ * other rounds are inserted (also in front of the window).  erase() and
+ * eraseBefore() invalidate the iterators to the diff states they remove.
+ */
+class DiffStateContainer
+{
+public:
+  class const_iterator : public boost::iterator_facade<const_iterator,
+                                                       const DiffStatePtr,
+                                                       boost::bidirectional_traversal_tag>
+  {
+  public:
+    const_iterator()
+      : m_container(0)
+      , m_round(0)
+      , m_isEnd(true)
+    {
+    }
+
+    const_iterator(const DiffStateContainer* container, RoundNo round, bool isEnd)
+      : m_container(container)
+      , m_round(round)
+      , m_isEnd(isEnd)
+    {
+    }
 
+  private:
+    friend class boost::iterator_core_access;
+
+    const DiffStatePtr&
+    dereference() const
+    {
+      return m_container->get(m_round);
+    }
+
+    bool
+    equal(const const_iterator& other) const
+    {
+      return m_isEnd == other.m_isEnd && (m_isEnd || m_round == other.m_round);
+    }
+
+    void
+    increment()
+    {
+      *this = m_container->lower_bound(m_round + 1);
+    }
+
+    void
+    decrement()
+    {
+      m_round = m_isEnd ? m_container->lastRound() : m_container->previousRound(m_round);
+      m_isEnd = false;
+    }
+
+  private:
+    const DiffStateContainer* m_container;
+    RoundNo m_round;
+    bool m_isEnd;
+  };
+
+  typedef const_iterator iterator;
+  typedef DiffStatePtr value_type;
+
+  static const size_t MAX_WINDOW_SIZE;
+
+public:
+  DiffStateContainer();
+
+  const_iterator
+  begin() const
+  {
+    return lower_bound(0);
+  }
+
+  const_iterator
+  end() const
+  {
+    return const_iterator(this, 0, true);
+  }
+
+  /**
+   * @brief Number of diff states (not slots) in the container
+   */
+  size_t
+  size() const
+  {
+    return m_size;
+  }
 
-struct RoundCompare
-{
   bool
-  operator()(RoundNo round1, RoundNo round2) const
+  empty() const
   {
-    return round1 < round2;
+    return m_size == 0;
   }
-};
 
+  const_iterator
+  find(RoundNo round) const
+  {
+    if (isInWindow(round) ? !m_slots[round - m_base] : m_sparse.find(round) == m_sparse.end())
+      return end();
+
+    return const_iterator(this, round, false);
+  }
 
+  /**
+   * @brief First diff state whose round is >= @p round
+   */
+  const_iterator
+  lower_bound(RoundNo round) const;
 
+  /**
+   * @brief First diff state whose round is > @p round
+   */
+  const_iterator
+  upper_bound(RoundNo round) const;
 
-/**
- * @brief Container for differential states
- */
-struct DiffStateContainer : public mi::multi_index_container<
-  DiffStatePtr,
-  mi::indexed_by<
-
-    mi::ordered_unique<
-      mi::tag<ordered_round>,
-      mi::const_mem_fun<DiffState, uint64_t, &DiffState::getRound>,
-      RoundCompare
-      >
-  >
->
-{
+  /**
+   * @brief Insert a diff state at the slot of its round
+   *
+   * @return iterator to the diff state of that round, and false if the round
+   *         already had one (which is kept)
+   */
+  std::pair<const_iterator, bool>
+  insert(const DiffStatePtr& state);
+
+  /**
+   * @brief Remove a diff state
+   *
+   * @return iterator to the next diff state
+   */
+  const_iterator
+  erase(const_iterator it);
+
+  /**
+   * @brief Remove all the diff states of rounds < @p round
+   */
+  void
+  eraseBefore(RoundNo round);
+
+  void
+  clear();
+
+private:
+  bool
+  isInWindow(RoundNo round) const
+  {
+    return round >= m_base && round - m_base < m_slots.size();
+  }
+
+  const DiffStatePtr&
+  get(RoundNo round) const
+  {
+    if (isInWindow(round))
+      return m_slots[round - m_base];
+    return m_sparse.find(round)->second;
+  }
+
+  /// @brief Round of the last diff state, which must exist
+  RoundNo
+  lastRound() const;
+
+  /// @brief Round of the last diff state before @p round, which must exist
+  RoundNo
+  previousRound(RoundNo round) const;
+
+  /**
+   * @brief Remove empty slots at both ends of the window
+   */
+  void
+  trim();
+
+private:
+  std::deque<DiffStatePtr> m_slots;
+  // round of m_slots.front()
+  RoundNo m_base;
+  // Diff states of the rounds that don't fit in the window
+  std::map<RoundNo, DiffStatePtr> m_sparse;
+  size_t m_size;
 };
 
 } // namespace chronosync
@@ -28,8 +28,19 @@
 
 #include "diff-state.hpp"
 
+#include <ndn-cxx/security/cryptopp.hpp>
+
 namespace chronosync {
 
+void
+DiffState::updateCumulativeDigest(const Digest& previousCumulativeDigest)
+{
+  CryptoPP::SHA256 hash;
+  hash.Update(previousCumulativeDigest.data(), previousCumulativeDigest.size());
+  hash.Update(m_roundDigest.data(), m_roundDigest.size());
+  hash.Final(m_cumulativeDigest.data());
+}
+
 ConstStatePtr
 DiffState::diff() const
 {
@@ -55,7 +66,7 @@ DiffState::getState() const
 
 
 DiffStatePtr
-DiffState::getStateFrom(Name prefix, bool& cumulativeOnly) const
+DiffState::getStateFrom(const SessionKey& prefix, bool& cumulativeOnly) const
 {
   LeafContainer::iterator leaf = getLeaves().find(prefix);
   
@@ -91,6 +102,55 @@ DiffState::setCumulativeInfo(CumulativeInfoPtr cumulativeInfo){
   m_cumulativeInfo = cumulativeInfo;
 }
 
+size_t
+DiffState::compact(const SessionKey& session)
+{
+  size_t usage = getMemoryUsage();
+
+  LeafContainer::iterator leaf = m_leaves.find(session);
+  bool hasLeaf = (leaf != m_leaves.end());
+  SeqNo seq = hasLeaf ? (*leaf)->getSeq() : 0;
+
+  // m_roundDigest and m_cumulativeDigest are stored apart from the leaves,
+  // so they are not affected
+  reset();
+  if (hasLeaf)
+    update(session, seq);
+
+  m_excludeFilter.clear();
+  m_next.reset();
+
+  return usage - getMemoryUsage();
+}
+
+size_t
+DiffState::getMemoryUsage() const
+{
+  size_t usage = sizeof(DiffState);
+
+  BOOST_FOREACH (ConstLeafRef leaf, m_leaves)
+    {
+      usage += sizeof(Leaf) + leaf->getSessionName().wireEncode().size();
+    }
+
+  if (!m_excludeFilter.empty())
+    usage += m_excludeFilter.wireEncode().size();
+
+  if (m_cumulativeInfo)
+    usage += sizeof(CumulativeInfo);
+
+  typedef std::map<Name, shared_ptr<const Data> >::value_type SignedData;
+  BOOST_FOREACH (const SignedData& signedData, m_signedData)
+    {
+      usage += signedData.second->wireEncode().size();
+    }
+
+  if (m_wire.hasWire())
+    usage += m_wire.size();
+
+  return usage;
+}
+
 
 
 
@@ -27,10 +27,12 @@
 #ifndef CHRONOSYNC_DIFF_STATE_HPP
 #define CHRONOSYNC_DIFF_STATE_HPP
 
-#include <ndn-cxx/util/scheduler.hpp>
-
 #include "state.hpp"
 
+#include <ndn-cxx/data.hpp>
+
+#include <map>
+
 namespace chronosync {
 
 typedef uint64_t RoundNo;
@@ -39,7 +41,7 @@ class DiffState;
 typedef shared_ptr<DiffState> DiffStatePtr;
 typedef shared_ptr<const DiffState> ConstDiffStatePtr;
 
-typedef std::pair<RoundNo, ndn::ConstBufferPtr> CumulativeInfo;
+typedef std::pair<RoundNo, Digest> CumulativeInfo;
 typedef shared_ptr<CumulativeInfo> CumulativeInfoPtr;
 
 
@@ -68,7 +70,7 @@ public:
    * @param digest root digest of the full state
    */
   void
-  setRootDigest(ndn::ConstBufferPtr rootDigest)
+  setRootDigest(const Digest& rootDigest)
   {
     m_rootDigest = rootDigest;
   }
@@ -76,7 +78,7 @@ public:
   /**
    * @brief Get root digest of the full state after applying the diff state
    */
-  ndn::ConstBufferPtr
+  const Digest&
   getRootDigest() const
   {
     return m_rootDigest;
@@ -88,14 +90,7 @@ public:
    * @param previousCumulativeDigest cumulative digest of the latest round before this 
    */
   void
-  updateCumulativeDigest(ndn::ConstBufferPtr previousCumulativeDigest)
-  {
-    sha256Digest.reset();
-    sha256Digest.update(previousCumulativeDigest->buf(), previousCumulativeDigest->size());
-    sha256Digest.update(getRoundDigest()->buf(), getRoundDigest()->size());
-
-    m_cumulativeDigest = sha256Digest.computeDigest();
-  }
+  updateCumulativeDigest(const Digest& previousCumulativeDigest);
 
   /**
    * @brief Set cumulative digest for the diff state 
@@ -103,15 +98,17 @@ public:
    * @param cumulativeDigest 
    */
   void
-  setCumulativeDigest(ndn::ConstBufferPtr cumulativeDigest)
+  setCumulativeDigest(const Digest& cumulativeDigest)
   {
     m_cumulativeDigest = cumulativeDigest;
   }
 
   /**
    * @brief Get cumulative digest the Round Log 
+   *
+   * It is all zeros (Digest::isZero()) until the round becomes stable.
    */
-  ndn::ConstBufferPtr
+  const Digest&
   getCumulativeDigest() const
   {
     return m_cumulativeDigest;
@@ -132,7 +129,7 @@ public:
   /**
    * @brief Get round digest for this diff state
    */
-  ndn::ConstBufferPtr
+  const Digest&
   getRoundDigest() const
   {
     return m_roundDigest;
@@ -171,6 +168,16 @@ public:
   }
 
 
+  /**
+   * @brief Whether @p exclude is in m_excludeFilter
+   */
+  bool
+  isExcluded(const ndn::name::Component& exclude) const
+  {
+    return m_excludeFilter.isExcluded(exclude);
+  }
+
+
   /**
    * @brief Append exclude to m_excludeFilter
    *
@@ -184,6 +191,33 @@ public:
   }
 
 
+  /**
+   * @brief Get the signed Data sent before for a Data Interest of this round
+   *
+   * @param name the Data Interest name
+   *
+   * @returns the Data, NULL if it is not cached
+   */
+  shared_ptr<const Data>
+  getSignedData(const Name& name) const
+  {
+    std::map<Name, shared_ptr<const Data> >::const_iterator it = m_signedData.find(name);
+    return it != m_signedData.end() ? it->second : shared_ptr<const Data>();
+  }
+
+
+  /**
+   * @brief Keep the signed Data sent for a Data Interest of this round
+   *
+   * The Data is cached as long as the diff state is in the round log.
+   */
+  void
+  setSignedData(const shared_ptr<const Data>& data)
+  {
+    m_signedData[data->getName()] = data;
+  }
+
+
   /**
    * @brief Accumulate differences from this state to the most current state
    *
@@ -214,7 +248,7 @@ public:
    * @returns state of this round if there is any produced by prefix, NULL otherwise
    */
   DiffStatePtr
-  getStateFrom(Name prefix, bool& cumulativeOnly) const;
+  getStateFrom(const SessionKey& prefix, bool& cumulativeOnly) const;
   
 
   CumulativeInfoPtr
@@ -223,43 +257,43 @@ public:
   void
   setCumulativeInfo(CumulativeInfoPtr cumulativeInfo);
 
-
-
   /**
-   * @brief 
+   * @brief Drop everything that is not needed once the round is old
+   *
+   * Only the leaf of @p session (if any), the cumulative info and the round
+   * and cumulative digests are kept, so the round can still be served with
+   * getStateFrom(session) and its cumulative digest compared.  The exclude
+   * filter is cleared.  The signed Data cache is kept, as it only holds Data
+   * produced by this node.
+   *
+   * @param session the session whose leaf must be kept (usually our own)
+   * @return estimated number of bytes reclaimed
    */
-  ndn::EventId
-  getReexpressingSyncInterestId() const
-  {
-    return m_reexpressingSyncInterestId;
-  }
+  size_t
+  compact(const SessionKey& session);
 
   /**
-   * @brief 
+   * @brief Estimated heap and object memory used by this diff state, in bytes
    */
-  void
-  setReexpressingSyncInterestId(ndn::EventId eventId) 
-  {
-    m_reexpressingSyncInterestId = eventId;
-  }
+  size_t
+  getMemoryUsage() const;
 
 
 
 private:
-  mutable ndn::util::Sha256 sha256Digest; 
-  ndn::ConstBufferPtr m_rootDigest; 
+  Digest m_rootDigest;
   ConstDiffStatePtr   m_next;
 
-  ndn::ConstBufferPtr m_cumulativeDigest;
-  ndn::ConstBufferPtr m_roundDigest; 
+  Digest m_cumulativeDigest;
+  Digest m_roundDigest;
   RoundNo m_round;
 
   ndn::Exclude m_excludeFilter;
 
   CumulativeInfoPtr m_cumulativeInfo;
 
-
-  ndn::EventId m_reexpressingSyncInterestId;
+  // Signed Data served for Data Interests of this round, by Interest name
+  std::map<Name, shared_ptr<const Data> > m_signedData;
 
 };
 
@@ -0,0 +1,122 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "digest.hpp"
+
+#include <ndn-cxx/security/cryptopp.hpp>
+
+namespace chronosync {
+
+const size_t Digest::SIZE;
+
+Digest::Digest(const uint8_t* buffer, size_t size)
+{
+  if (size != SIZE)
+    throw Error("Digest must be " + boost::lexical_cast<std::string>(SIZE) +
+                " bytes long, got " + boost::lexical_cast<std::string>(size));
+
+  std::memcpy(m_bytes.data(), buffer, SIZE);
+}
+
+Digest::Digest(const ndn::name::Component& component)
+{
+  *this = Digest(component.value(), component.value_size());
+}
+
+Digest
+Digest::sha256(const uint8_t* buffer, size_t size)
+{
+  BOOST_ASSERT(static_cast<size_t>(CryptoPP::SHA256::DIGESTSIZE) == SIZE);
+
+  Digest digest;
+  CryptoPP::SHA256 hash;
+  hash.Update(buffer, size);
+  hash.Final(digest.data());
+  return digest;
+}
+
+bool
+Digest::isZero() const
+{
+  for (size_t i = 0; i < SIZE; ++i) {
+    if (m_bytes[i] != 0)
+      return false;
+  }
+  return true;
+}
+
+Digest&
+Digest::operator+=(const Digest& other)
+{
+  unsigned carry = 0;
+  for (size_t i = SIZE; i > 0; --i) {
+    unsigned value = m_bytes[i - 1] + other.m_bytes[i - 1] + carry;
+    m_bytes[i - 1] = static_cast<uint8_t>(value);
+    carry = value >> 8;
+  }
+  return *this;
+}
+
+Digest&
+Digest::operator-=(const Digest& other)
+{
+  int borrow = 0;
+  for (size_t i = SIZE; i > 0; --i) {
+    int value = m_bytes[i - 1] - other.m_bytes[i - 1] - borrow;
+    borrow = value < 0 ? 1 : 0;
+    m_bytes[i - 1] = static_cast<uint8_t>(value + (borrow << 8));
+  }
+  return *this;
+}
+
+ndn::name::Component
+Digest::toComponent() const
+{
+  return ndn::name::Component(m_bytes.data(), SIZE);
+}
+
+ndn::ConstBufferPtr
+Digest::toBuffer() const
+{
+  return make_shared<ndn::Buffer>(m_bytes.data(), SIZE);
+}
+
+std::string
+Digest::toString() const
+{
+  static const char HEX[] = "0123456789abcdef";
+
+  std::string result(2 * SIZE, '0');
+  for (size_t i = 0; i < SIZE; ++i) {
+    result[2 * i] = HEX[m_bytes[i] >> 4];
+    result[2 * i + 1] = HEX[m_bytes[i] & 0x0f];
+  }
+  return result;
+}
+
+std::ostream&
+operator<<(std::ostream& os, const Digest& digest)
+{
+  return os << digest.toString();
+}
+
+} // namespace chronosync
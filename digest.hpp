@@ -0,0 +1,193 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_DIGEST_HPP
+#define CHRONOSYNC_DIGEST_HPP
+
+#include "common-chronosync.hpp"
+
+#include <array>
+#include <cstring>
+
+namespace chronosync {
+
+/**
+ * @brief SHA-256 digest stored inline
+ *
+ * Digest is a trivially copyable 32-byte value used for leaf, root, round and
+ * cumulative digests.  It is converted to ndn-cxx types (name::Component,
+ * ConstBufferPtr) only when it is put in or taken from a packet.
+ *
+ * A default constructed Digest is all zeros, which is used as "not computed
+ * yet" (see isZero()).
+ */
+class Digest
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  static const size_t SIZE = 32;
+
+  typedef std::array<uint8_t, SIZE> Bytes;
+
+  constexpr
+  Digest()
+    : m_bytes()
+  {
+  }
+
+  constexpr explicit
+  Digest(const Bytes& bytes)
+    : m_bytes(bytes)
+  {
+  }
+
+  /**
+   * @brief Create a digest from a buffer
+   *
+   * @throws Error if @p size is not Digest::SIZE
+   */
+  Digest(const uint8_t* buffer, size_t size);
+
+  /**
+   * @brief Create a digest from the value of a name component
+   *
+   * @throws Error if the component value is not Digest::SIZE bytes long
+   */
+  explicit
+  Digest(const ndn::name::Component& component);
+
+  /**
+   * @brief SHA-256 of @p size bytes starting at @p buffer
+   */
+  static Digest
+  sha256(const uint8_t* buffer, size_t size);
+
+  const uint8_t*
+  data() const
+  {
+    return m_bytes.data();
+  }
+
+  uint8_t*
+  data()
+  {
+    return m_bytes.data();
+  }
+
+  constexpr size_t
+  size() const
+  {
+    return SIZE;
+  }
+
+  bool
+  isZero() const;
+
+  /**
+   * @brief Add @p other to this digest, both taken as big-endian 256-bit
+   *        integers (mod 2^256)
+   */
+  Digest&
+  operator+=(const Digest& other);
+
+  /**
+   * @brief Subtract @p other from this digest (mod 2^256)
+   */
+  Digest&
+  operator-=(const Digest& other);
+
+  ndn::name::Component
+  toComponent() const;
+
+  ndn::ConstBufferPtr
+  toBuffer() const;
+
+  /**
+   * @brief Lowercase hexadecimal representation
+   */
+  std::string
+  toString() const;
+
+  bool
+  operator==(const Digest& other) const
+  {
+    return std::memcmp(m_bytes.data(), other.m_bytes.data(), SIZE) == 0;
+  }
+
+  bool
+  operator!=(const Digest& other) const
+  {
+    return !(*this == other);
+  }
+
+  bool
+  operator<(const Digest& other) const
+  {
+    return std::memcmp(m_bytes.data(), other.m_bytes.data(), SIZE) < 0;
+  }
+
+private:
+  Bytes m_bytes;
+};
+
+/**
+ * @brief Hash functor for unordered containers keyed by Digest
+ *
+ * The bytes of a digest are already uniformly distributed, so the first
+ * machine word is used as the hash.
+ */
+struct DigestHash
+{
+  size_t
+  operator()(const Digest& digest) const
+  {
+    size_t hash;
+    std::memcpy(&hash, digest.data(), sizeof(hash));
+    return hash;
+  }
+};
+
+/**
+ * @brief Digest of an empty state: SHA-256 of the empty string
+ */
+constexpr Digest EMPTY_DIGEST(Digest::Bytes{{
+  0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14,
+  0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+  0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c,
+  0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55
+}});
+
+std::ostream&
+operator<<(std::ostream& os, const Digest& digest);
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_DIGEST_HPP
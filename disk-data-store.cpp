@@ -0,0 +1,595 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "disk-data-store.hpp"
+#include "file-io.hpp"
+#include "tlv.hpp"
+#include "logger.hpp"
+
+#include <cerrno>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+INIT_LOGGER("DiskDataStore")
+
+namespace chronosync {
+
+// Segments are started every 64 MiB
+const size_t DiskDataStore::DEFAULT_SEGMENT_SIZE(64 * 1024 * 1024);
+
+static const std::string SEGMENT_PREFIX("segment-");
+
+// Segment, offset and size of a packet, each a 32-bit big-endian integer
+static const size_t LOCATION_SIZE = 12;
+
+// A session whose new seqNo is further than this from its indexed seqNos
+// is indexed again from that seqNo, instead of growing the index by the gap
+static const SeqNo MAX_SEQ_GAP = 65536;
+
+static void
+putUint32(uint8_t* buffer, uint32_t value)
+{
+  buffer[0] = value >> 24;
+  buffer[1] = value >> 16;
+  buffer[2] = value >> 8;
+  buffer[3] = value;
+}
+
+static uint32_t
+getUint32(const uint8_t* buffer)
+{
+  return (static_cast<uint32_t>(buffer[0]) << 24) | (static_cast<uint32_t>(buffer[1]) << 16) |
+         (static_cast<uint32_t>(buffer[2]) << 8) | static_cast<uint32_t>(buffer[3]);
+}
+
+/**
+ * @brief Split the name of a packet into its session and seqNo
+ */
+static bool
+parseName(const Name& name, Name& session, SeqNo& seq)
+{
+  if (name.empty())
+    return false;
+
+  try {
+    seq = name.get(-1).toNumber();
+  }
+  catch (ndn::tlv::Error&) {
+    return false;
+  }
+  session = name.getPrefix(-1);
+  return true;
+}
+
+DiskDataStore::DiskDataStore(const std::string& directory,
+                             size_t segmentSize,
+                             size_t maxSegments)
+  : m_directory(directory)
+  , m_indexPath(directory + "/index")
+  , m_segmentSize(segmentSize)
+  , m_maxSegments(maxSegments)
+  , m_currentSegment(0)
+  , m_fd(-1)
+{
+  if (m_segmentSize == 0 || m_segmentSize > 0xffffffff)
+    throw Error("Invalid segment size");
+
+  if (::mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+    throw Error(FileIo::errorString("Cannot create", directory));
+
+  DIR* dir = ::opendir(directory.c_str());
+  if (dir == 0)
+    throw Error(FileIo::errorString("Cannot open", directory));
+
+  std::set<uint32_t> segments;
+  while (struct dirent* entry = ::readdir(dir)) {
+    std::string fileName(entry->d_name);
+    if (fileName.compare(0, SEGMENT_PREFIX.size(), SEGMENT_PREFIX) != 0)
+      continue;
+
+    try {
+      segments.insert(boost::lexical_cast<uint32_t>(fileName.substr(SEGMENT_PREFIX.size())));
+    }
+    catch (boost::bad_lexical_cast&) {
+    }
+  }
+  ::closedir(dir);
+
+  BOOST_FOREACH (uint32_t no, segments)
+    {
+      std::string path = getSegmentPath(no);
+      struct stat st;
+      if (::stat(path.c_str(), &st) != 0)
+        throw Error(FileIo::errorString("Cannot stat", path));
+      mapSegment(no, st.st_size);
+    }
+
+  uint32_t indexSegment = 0;
+  size_t indexOffset = 0;
+  if (!loadIndex(indexSegment, indexOffset)) {
+    m_index.clear();
+    m_stats = Stats();
+    indexSegment = 0;
+    indexOffset = 0;
+  }
+
+  // Only the packets appended after the index was written are scanned
+  openSegment(segments.empty() ? 0 : *segments.rbegin());
+  for (std::map<uint32_t, Segment>::iterator it = m_segments.lower_bound(indexSegment);
+       it != m_segments.end(); ++it)
+    scanSegment(it->first, it->first == indexSegment ? indexOffset : 0);
+
+  while (m_maxSegments != 0 && m_segments.size() > m_maxSegments)
+    removeOldestSegment();
+}
+
+DiskDataStore::~DiskDataStore()
+{
+  try {
+    writeIndex();
+  }
+  catch (Error& e) {
+    _LOG_ERROR("DiskDataStore: " << e.what());
+  }
+
+  if (m_fd >= 0)
+    ::close(m_fd);
+
+  for (std::map<uint32_t, Segment>::iterator it = m_segments.begin();
+       it != m_segments.end(); ++it)
+    ::munmap(const_cast<uint8_t*>(it->second.data), it->second.mappedSize);
+}
+
+std::string
+DiskDataStore::getSegmentPath(uint32_t segment) const
+{
+  return m_directory + "/" + SEGMENT_PREFIX + boost::lexical_cast<std::string>(segment);
+}
+
+void
+DiskDataStore::mapSegment(uint32_t no, size_t size)
+{
+  std::string path = getSegmentPath(no);
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw Error(FileIo::errorString("Cannot open", path));
+
+  // The mapping covers a whole segment, so the packets appended later are
+  // seen through it (mapped pages beyond the end of the file are not read)
+  size_t mappedSize = std::max(size, m_segmentSize);
+  void* data = ::mmap(0, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    throw Error(FileIo::errorString("Cannot map", path));
+
+  Segment segment = { static_cast<const uint8_t*>(data), mappedSize, size };
+  m_segments[no] = segment;
+}
+
+void
+DiskDataStore::openSegment(uint32_t no)
+{
+  std::string path = getSegmentPath(no);
+
+  if (m_fd >= 0)
+    ::close(m_fd);
+
+  m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (m_fd < 0)
+    throw Error(FileIo::errorString("Cannot open", path));
+
+  if (m_segments.find(no) == m_segments.end())
+    mapSegment(no, 0);
+  m_currentSegment = no;
+}
+
+void
+DiskDataStore::removeOldestSegment()
+{
+  std::map<uint32_t, Segment>::iterator oldest = m_segments.begin();
+  if (oldest == m_segments.end() || oldest->first == m_currentSegment)
+    return;
+  uint32_t no = oldest->first;
+
+  std::map<Name, SessionIndex>::iterator it = m_index.begin();
+  while (it != m_index.end()) {
+    std::vector<Location>& locations = it->second.locations;
+    for (size_t i = 0; i < locations.size(); ++i) {
+      if (locations[i].size != 0 && locations[i].segment == no) {
+        m_stats.nPackets--;
+        m_stats.nBytes -= locations[i].size;
+        m_stats.nEvicted++;
+        locations[i].size = 0;
+      }
+    }
+
+    size_t nEmpty = 0;
+    while (nEmpty < locations.size() && locations[nEmpty].size == 0)
+      nEmpty++;
+    locations.erase(locations.begin(), locations.begin() + nEmpty);
+    it->second.firstSeq += nEmpty;
+
+    if (locations.empty())
+      m_index.erase(it++);
+    else
+      ++it;
+  }
+
+  ::munmap(const_cast<uint8_t*>(oldest->second.data), oldest->second.mappedSize);
+  m_segments.erase(oldest);
+
+  std::string path = getSegmentPath(no);
+  if (::unlink(path.c_str()) != 0)
+    _LOG_ERROR("DiskDataStore: " << FileIo::errorString("Cannot remove", path));
+}
+
+void
+DiskDataStore::addLocation(const Name& name, const Location& location)
+{
+  Name session;
+  SeqNo seq = 0;
+  if (!parseName(name, session, seq))
+    return;
+
+  SessionIndex& index = m_index[session];
+  std::vector<Location>& locations = index.locations;
+
+  bool isTooFar = !locations.empty() &&
+    (seq + MAX_SEQ_GAP < index.firstSeq || seq > index.firstSeq + locations.size() + MAX_SEQ_GAP);
+  if (isTooFar) {
+    for (size_t i = 0; i < locations.size(); ++i) {
+      if (locations[i].size != 0) {
+        m_stats.nPackets--;
+        m_stats.nBytes -= locations[i].size;
+        m_stats.nEvicted++;
+      }
+    }
+    locations.clear();
+  }
+
+  Location empty = { 0, 0, 0 };
+  if (locations.empty())
+    index.firstSeq = seq;
+  else if (seq < index.firstSeq) {
+    locations.insert(locations.begin(), index.firstSeq - seq, empty);
+    index.firstSeq = seq;
+  }
+
+  size_t i = seq - index.firstSeq;
+  if (i >= locations.size())
+    locations.resize(i + 1, empty);
+
+  if (locations[i].size != 0) {
+    m_stats.nPackets--;
+    m_stats.nBytes -= locations[i].size;
+  }
+  locations[i] = location;
+  m_stats.nPackets++;
+  m_stats.nBytes += location.size;
+}
+
+void
+DiskDataStore::insert(const Data& data)
+{
+  Name session;
+  SeqNo seq = 0;
+  if (!parseName(data.getName(), session, seq))
+    throw Error("Not a <session>/<seqNo> name: " + data.getName().toUri());
+
+  const Block& wire = data.wireEncode();
+  if (wire.size() > m_segmentSize)
+    throw Error("Data larger than a segment: " + data.getName().toUri());
+
+  if (m_segments[m_currentSegment].size + wire.size() > m_segmentSize) {
+    openSegment(m_currentSegment + 1);
+    while (m_maxSegments != 0 && m_segments.size() > m_maxSegments)
+      removeOldestSegment();
+  }
+
+  Segment& segment = m_segments[m_currentSegment];
+  try {
+    FileIo::writeAll(m_fd, wire.wire(), wire.size(), getSegmentPath(m_currentSegment));
+  }
+  catch (FileIo::Error& e) {
+    // Don't leave part of the packet before the next ones
+    if (::ftruncate(m_fd, segment.size) != 0)
+      _LOG_ERROR("DiskDataStore: "
+                 << FileIo::errorString("Cannot truncate", getSegmentPath(m_currentSegment)));
+    throw Error(e.what());
+  }
+
+  Location location = { m_currentSegment,
+                        static_cast<uint32_t>(segment.size),
+                        static_cast<uint32_t>(wire.size()) };
+  segment.size += wire.size();
+
+  addLocation(data.getName(), location);
+  m_stats.nInserted++;
+}
+
+shared_ptr<const Data>
+DiskDataStore::find(const Interest& interest)
+{
+  Name session;
+  SeqNo seq = 0;
+  if (!parseName(interest.getName(), session, seq)) {
+    m_stats.nMisses++;
+    return shared_ptr<const Data>();
+  }
+
+  std::map<Name, SessionIndex>::const_iterator index = m_index.find(session);
+  if (index == m_index.end() || seq < index->second.firstSeq ||
+      seq - index->second.firstSeq >= index->second.locations.size()) {
+    m_stats.nMisses++;
+    return shared_ptr<const Data>();
+  }
+
+  const Location& location = index->second.locations[seq - index->second.firstSeq];
+  std::map<uint32_t, Segment>::const_iterator segment = m_segments.find(location.segment);
+  if (location.size == 0 || segment == m_segments.end() ||
+      static_cast<uint64_t>(location.offset) + location.size > segment->second.size) {
+    m_stats.nMisses++;
+    return shared_ptr<const Data>();
+  }
+
+  try {
+    // Decoded straight from the mapping, the Block being the only copy
+    shared_ptr<Data> data =
+      make_shared<Data>(Block(segment->second.data + location.offset, location.size));
+    if (interest.matchesData(*data)) {
+      m_stats.nHits++;
+      return data;
+    }
+  }
+  catch (ndn::tlv::Error& e) {
+    _LOG_ERROR("DiskDataStore: corrupted packet " << interest.getName() << ": " << e.what());
+  }
+
+  m_stats.nMisses++;
+  return shared_ptr<const Data>();
+}
+
+void
+DiskDataStore::erase(const Name& prefix)
+{
+  // A single packet
+  Name session;
+  SeqNo seq = 0;
+  if (parseName(prefix, session, seq)) {
+    std::map<Name, SessionIndex>::iterator index = m_index.find(session);
+    if (index != m_index.end() && seq >= index->second.firstSeq &&
+        seq - index->second.firstSeq < index->second.locations.size()) {
+      Location& location = index->second.locations[seq - index->second.firstSeq];
+      if (location.size != 0) {
+        m_stats.nPackets--;
+        m_stats.nBytes -= location.size;
+        location.size = 0;
+      }
+    }
+  }
+
+  // Whole sessions
+  std::map<Name, SessionIndex>::iterator it = m_index.lower_bound(prefix);
+  while (it != m_index.end() && prefix.isPrefixOf(it->first)) {
+    BOOST_FOREACH (const Location& location, it->second.locations)
+      {
+        if (location.size != 0) {
+          m_stats.nPackets--;
+          m_stats.nBytes -= location.size;
+        }
+      }
+    m_index.erase(it++);
+  }
+}
+
+void
+DiskDataStore::scanSegment(uint32_t no, size_t offset)
+{
+  Segment& segment = m_segments[no];
+
+  while (offset < segment.size) {
+    const uint8_t* begin = segment.data + offset;
+    const uint8_t* end = segment.data + segment.size;
+
+    // Only the headers and the name of the packet are read
+    uint64_t type = 0;
+    uint64_t length = 0;
+    if (!ndn::tlv::readVarNumber(begin, end, type) || type != ndn::tlv::Data ||
+        !ndn::tlv::readVarNumber(begin, end, length) ||
+        length > static_cast<uint64_t>(end - begin))
+      break;
+    size_t size = begin - (segment.data + offset) + length;
+
+    const uint8_t* nameBegin = begin;
+    uint64_t nameLength = 0;
+    if (!ndn::tlv::readVarNumber(begin, end, type) || type != ndn::tlv::Name ||
+        !ndn::tlv::readVarNumber(begin, end, nameLength) ||
+        begin + nameLength > nameBegin + length)
+      break;
+
+    try {
+      Name name(Block(nameBegin, begin - nameBegin + nameLength));
+      Location location = { no, static_cast<uint32_t>(offset), static_cast<uint32_t>(size) };
+      addLocation(name, location);
+    }
+    catch (ndn::tlv::Error&) {
+      break;
+    }
+    offset += size;
+  }
+
+  if (offset < segment.size) {
+    _LOG_DEBUG("DiskDataStore: ignoring " << segment.size - offset << " bytes at the end of "
+               << getSegmentPath(no));
+
+    // Drop the torn packet, so new packets are appended after the last good one
+    if (no == m_currentSegment) {
+      if (::ftruncate(m_fd, offset) != 0)
+        throw Error(FileIo::errorString("Cannot truncate", getSegmentPath(no)));
+      segment.size = offset;
+    }
+  }
+}
+
+bool
+DiskDataStore::loadIndex(uint32_t& segment, size_t& offset)
+{
+  int fd = ::open(m_indexPath.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void* data = ::mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  bool isLoaded = false;
+  try {
+    Block wire;
+    if (!Block::fromBuffer(static_cast<const uint8_t*>(data), st.st_size, wire) ||
+        wire.type() != tlv::StoreIndex)
+      throw Error("Corrupted index " + m_indexPath);
+
+    wire.parse();
+    Block::element_const_iterator it = wire.elements_begin();
+    Block::element_const_iterator end = wire.elements_end();
+
+    if (it == end || it->type() != tlv::SegmentNo)
+      throw Error("No segment in index");
+    segment = readNonNegativeInteger(*it);
+    it++;
+
+    if (it == end || it->type() != tlv::SegmentOffset)
+      throw Error("No segment offset in index");
+    offset = readNonNegativeInteger(*it);
+    it++;
+
+    for (; it != end; it++) {
+      if (it->type() != tlv::IndexSession)
+        throw Error("Expecting IndexSession in index");
+
+      it->parse();
+      Block::element_const_iterator val = it->elements_begin();
+      if (val == it->elements_end() || val->type() != ndn::tlv::Name)
+        throw Error("No session name in IndexSession");
+      Name session(*val);
+      val++;
+
+      if (val == it->elements_end() || val->type() != tlv::SeqNo)
+        throw Error("No seqNo in IndexSession");
+      SessionIndex& index = m_index[session];
+      index.firstSeq = readNonNegativeInteger(*val);
+      val++;
+
+      if (val == it->elements_end() || val->type() != tlv::IndexLocations ||
+          val->value_size() % LOCATION_SIZE != 0)
+        throw Error("No locations in IndexSession");
+      index.locations.resize(val->value_size() / LOCATION_SIZE);
+      for (size_t i = 0; i < index.locations.size(); ++i) {
+        const uint8_t* record = val->value() + i * LOCATION_SIZE;
+        Location& location = index.locations[i];
+        location.segment = getUint32(record);
+        location.offset = getUint32(record + 4);
+        location.size = getUint32(record + 8);
+        if (location.size != 0) {
+          m_stats.nPackets++;
+          m_stats.nBytes += location.size;
+        }
+      }
+    }
+    isLoaded = true;
+  }
+  catch (std::runtime_error& e) {
+    _LOG_ERROR("DiskDataStore: " << e.what() << ", scanning all segments");
+  }
+
+  ::munmap(data, st.st_size);
+  return isLoaded;
+}
+
+template<bool T>
+size_t
+DiskDataStore::encodeIndex(ndn::EncodingImpl<T>& block) const
+{
+  size_t totalLength = 0;
+
+  for (std::map<Name, SessionIndex>::const_reverse_iterator it = m_index.rbegin();
+       it != m_index.rend(); ++it) {
+    const std::vector<Location>& locations = it->second.locations;
+
+    std::vector<uint8_t> records(locations.size() * LOCATION_SIZE);
+    for (size_t i = 0; i < locations.size(); ++i) {
+      uint8_t* record = &records[i * LOCATION_SIZE];
+      putUint32(record, locations[i].segment);
+      putUint32(record + 4, locations[i].offset);
+      putUint32(record + 8, locations[i].size);
+    }
+
+    size_t length = 0;
+    length += prependByteArrayBlock(block, tlv::IndexLocations, records.data(), records.size());
+    length += prependNonNegativeIntegerBlock(block, tlv::SeqNo, it->second.firstSeq);
+    length += it->first.wireEncode(block);
+    length += block.prependVarNumber(length);
+    length += block.prependVarNumber(tlv::IndexSession);
+    totalLength += length;
+  }
+
+  std::map<uint32_t, Segment>::const_iterator current = m_segments.find(m_currentSegment);
+  size_t offset = current != m_segments.end() ? current->second.size : 0;
+  totalLength += prependNonNegativeIntegerBlock(block, tlv::SegmentOffset, offset);
+  totalLength += prependNonNegativeIntegerBlock(block, tlv::SegmentNo, m_currentSegment);
+
+  totalLength += block.prependVarNumber(totalLength);
+  totalLength += block.prependVarNumber(tlv::StoreIndex);
+
+  return totalLength;
+}
+
+void
+DiskDataStore::writeIndex()
+{
+  ndn::EncodingEstimator estimator;
+  size_t estimatedSize = encodeIndex(estimator);
+
+  ndn::EncodingBuffer buffer(estimatedSize, 0);
+  encodeIndex(buffer);
+  Block wire = buffer.block();
+
+  try {
+    FileIo::replaceFile(m_directory, m_indexPath, wire);
+  }
+  catch (FileIo::Error& e) {
+    throw Error(e.what());
+  }
+}
+
+} // namespace chronosync
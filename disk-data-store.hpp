@@ -0,0 +1,182 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_DISK_DATA_STORE_HPP
+#define CHRONOSYNC_DISK_DATA_STORE_HPP
+
+#include "data-store.hpp"
+#include "leaf.hpp"
+
+#include <map>
+
+namespace chronosync {
+
+/**
+ * @brief DataStore that keeps the packets on disk
+ *
+ * The wire encodings of the packets are appended to segment files
+ * ("segment-<n>" in the store directory), a new one being started when
+ * the current one reaches segmentSize bytes.  Segments are mapped in
+ * memory, so lookups read the packets from the page cache without any
+ * system call.  If there are more than maxSegments segments, the oldest
+ * one is removed with its packets.
+ *
+ * Only the location of each packet is kept in memory: packets are named
+ * <session>/<seqNo> and, as the seqNos of a session are consecutive, the
+ * index of a session is an array of (segment, offset, size) records from
+ * its first seqNo.
+ *
+ * The index is written to the "index" file (a StoreIndex TLV block) when
+ * the store is destroyed, or by writeIndex().  When the store is opened,
+ * the index is read and only the packets appended after it was written
+ * are scanned.  A torn packet at the end of the last segment is truncated.
+ * The index is replaced atomically and synced to the disk; the segments
+ * are not synced, so a crash of the host may lose the last packets.
+ *
+ * Interests are only answered when their name is exactly the name of a
+ * packet.  Packets removed with erase() are found again by a scan if the
+ * index is lost.
+ */
+class DiskDataStore : public DataStore
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  static const size_t DEFAULT_SEGMENT_SIZE;
+
+  /**
+   * @brief Open (creating it if needed) the store in @p directory
+   *
+   * @param maxSegments segments kept, 0 for no limit
+   * @throws Error if the directory or the segments can't be created or opened
+   */
+  explicit
+  DiskDataStore(const std::string& directory,
+                size_t segmentSize = DEFAULT_SEGMENT_SIZE,
+                size_t maxSegments = 0);
+
+  virtual
+  ~DiskDataStore();
+
+  /**
+   * @throws Error if the packet can't be written
+   */
+  virtual void
+  insert(const Data& data);
+
+  virtual shared_ptr<const Data>
+  find(const Interest& interest);
+
+  virtual void
+  erase(const Name& prefix);
+
+  /**
+   * @brief Replace the index file with the current index
+   *
+   * @throws Error if the index can't be written
+   */
+  void
+  writeIndex();
+
+private:
+  struct Location
+  {
+    uint32_t segment;
+    uint32_t offset;
+    /// zero if there is no packet
+    uint32_t size;
+  };
+
+  struct SessionIndex
+  {
+    SessionIndex()
+      : firstSeq(0)
+    {
+    }
+
+    SeqNo firstSeq;
+    std::vector<Location> locations;
+  };
+
+  struct Segment
+  {
+    const uint8_t* data;
+    size_t mappedSize;
+    size_t size;
+  };
+
+  std::string
+  getSegmentPath(uint32_t segment) const;
+
+  /// @brief Map segment @p no, whose file holds @p size bytes
+  void
+  mapSegment(uint32_t no, size_t size);
+
+  /// @brief Start a new segment to append packets to
+  void
+  openSegment(uint32_t no);
+
+  /// @brief Remove the oldest segment and the locations in it
+  void
+  removeOldestSegment();
+
+  /// @brief Add the location of the packet @p name
+  void
+  addLocation(const Name& name, const Location& location);
+
+  /// @brief Read the index file; false if it is missing or corrupted
+  bool
+  loadIndex(uint32_t& segment, size_t& offset);
+
+  /// @brief Index the packets of segment @p no from @p offset on
+  void
+  scanSegment(uint32_t no, size_t offset);
+
+  template<bool T>
+  size_t
+  encodeIndex(ndn::EncodingImpl<T>& block) const;
+
+private:
+  std::string m_directory;
+  std::string m_indexPath;
+  size_t m_segmentSize;
+  size_t m_maxSegments;
+
+  std::map<uint32_t, Segment> m_segments;
+  // Segment packets are appended to, the last one of m_segments
+  uint32_t m_currentSegment;
+  int m_fd;
+
+  std::map<Name, SessionIndex> m_index;
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_DISK_DATA_STORE_HPP
@@ -0,0 +1,99 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "file-io.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace chronosync {
+
+std::string
+FileIo::errorString(const std::string& what, const std::string& path)
+{
+  return what + " " + path + ": " + std::strerror(errno);
+}
+
+void
+FileIo::writeAll(int fd, const uint8_t* buffer, size_t size, const std::string& path)
+{
+  while (size > 0) {
+    ssize_t written = ::write(fd, buffer, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      throw Error(errorString("Cannot write", path));
+    }
+    buffer += written;
+    size -= written;
+  }
+}
+
+void
+FileIo::syncFile(int fd, const std::string& path)
+{
+  if (::fsync(fd) != 0)
+    throw Error(errorString("Cannot sync", path));
+}
+
+void
+FileIo::syncDirectory(const std::string& path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw Error(errorString("Cannot open", path));
+
+  int result = ::fsync(fd);
+  ::close(fd);
+  if (result != 0)
+    throw Error(errorString("Cannot sync", path));
+}
+
+void
+FileIo::replaceFile(const std::string& directory, const std::string& path, const Block& wire)
+{
+  std::string tmpPath = path + ".tmp";
+  int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    throw Error(errorString("Cannot open", tmpPath));
+
+  try {
+    writeAll(fd, wire.wire(), wire.size(), tmpPath);
+    // The data must be on disk before the rename is
+    syncFile(fd, tmpPath);
+  }
+  catch (Error&) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+
+  if (::rename(tmpPath.c_str(), path.c_str()) != 0)
+    throw Error(errorString("Cannot rename", tmpPath));
+
+  syncDirectory(directory);
+}
+
+} // namespace chronosync
@@ -0,0 +1,91 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_FILE_IO_HPP
+#define CHRONOSYNC_FILE_IO_HPP
+
+#include "common-chronosync.hpp"
+
+namespace chronosync {
+
+/**
+ * @brief File helpers shared by the on-disk stores (StateStore, DiskDataStore)
+ */
+class FileIo
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  /**
+   * @brief Describe the failure of an operation on @p path, with errno
+   */
+  static std::string
+  errorString(const std::string& what, const std::string& path);
+
+  /**
+   * @brief Write the whole @p buffer to @p fd, retrying partial writes
+   *
+   * @throws Error if the write fails
+   */
+  static void
+  writeAll(int fd, const uint8_t* buffer, size_t size, const std::string& path);
+
+  /**
+   * @brief Flush the data of the file @p fd to the disk
+   *
+   * @throws Error if the sync fails
+   */
+  static void
+  syncFile(int fd, const std::string& path);
+
+  /**
+   * @brief Flush the entries of a directory (e.g., a rename) to the disk
+   *
+   * @throws Error if the directory can't be opened or synced
+   */
+  static void
+  syncDirectory(const std::string& path);
+
+  /**
+   * @brief Replace the file @p path of @p directory with @p wire, atomically
+   *
+   * The content is written to a temporary file, synced and renamed over
+   * @p path, and the directory is synced: once this returns, the new content
+   * survives a crash of the host.
+   *
+   * @throws Error if the file can't be written
+   */
+  static void
+  replaceFile(const std::string& directory, const std::string& path, const Block& wire);
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_FILE_IO_HPP
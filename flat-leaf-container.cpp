@@ -0,0 +1,292 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "flat-leaf-container.hpp"
+
+#include <algorithm>
+
+namespace chronosync {
+
+const uint32_t FlatHashIndex::NPOS = 0xffffffff;
+
+FlatHashIndex::FlatHashIndex()
+  : m_size(0)
+{
+}
+
+void
+FlatHashIndex::insert(uint64_t hash, uint32_t id)
+{
+  // keep the load factor under 1/2
+  if (2 * (m_size + 1) > m_slots.size())
+    grow();
+
+  size_t mask = m_slots.size() - 1;
+  size_t i = static_cast<size_t>(hash) & mask;
+  while (m_slots[i].id != NPOS)
+    i = (i + 1) & mask;
+
+  m_slots[i].hash = hash;
+  m_slots[i].id = id;
+  ++m_size;
+}
+
+void
+FlatHashIndex::erase(uint64_t hash, uint32_t id)
+{
+  if (m_slots.empty())
+    return;
+
+  size_t mask = m_slots.size() - 1;
+  size_t i = static_cast<size_t>(hash) & mask;
+  while (m_slots[i].id != id) {
+    if (m_slots[i].id == NPOS)
+      return;
+    i = (i + 1) & mask;
+  }
+
+  // Move back the entries of the probe sequence that follows, so that
+  // lookups don't stop at the freed slot
+  size_t j = i;
+  for (;;) {
+    m_slots[i].id = NPOS;
+    for (;;) {
+      j = (j + 1) & mask;
+      if (m_slots[j].id == NPOS) {
+        --m_size;
+        return;
+      }
+
+      // An entry whose home slot is cyclically in (i, j] stays
+      size_t home = static_cast<size_t>(m_slots[j].hash) & mask;
+      if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+        continue;
+      break;
+    }
+
+    m_slots[i] = m_slots[j];
+    i = j;
+  }
+}
+
+void
+FlatHashIndex::clear()
+{
+  m_slots.clear();
+  m_size = 0;
+}
+
+void
+FlatHashIndex::grow()
+{
+  std::vector<Slot> old;
+  old.swap(m_slots);
+
+  Slot empty = {0, NPOS};
+  m_slots.resize(old.empty() ? 16 : 2 * old.size(), empty);
+  m_size = 0;
+
+  for (std::vector<Slot>::const_iterator it = old.begin(); it != old.end(); ++it) {
+    if (it->id != NPOS)
+      insert(it->hash, it->id);
+  }
+}
+
+
+SessionNameTable&
+SessionNameTable::getInstance()
+{
+  static SessionNameTable instance;
+  return instance;
+}
+
+SessionNameTable::SessionNameTable()
+{
+}
+
+uint32_t
+SessionNameTable::intern(const SessionKey& key)
+{
+  uint32_t id = m_index.find(key.hash,
+                             [&] (uint32_t candidate) { return m_names[candidate] == key.name; });
+  if (id != FlatHashIndex::NPOS) {
+    ++m_refCounts[id];
+    return id;
+  }
+
+  if (!m_freeIds.empty()) {
+    id = m_freeIds.back();
+    m_freeIds.pop_back();
+    m_names[id] = key.name;
+    m_hashes[id] = key.hash;
+    m_refCounts[id] = 1;
+  }
+  else {
+    id = static_cast<uint32_t>(m_names.size());
+    m_names.push_back(key.name);
+    m_hashes.push_back(key.hash);
+    m_refCounts.push_back(1);
+  }
+
+  m_index.insert(key.hash, id);
+  return id;
+}
+
+void
+SessionNameTable::release(uint32_t id)
+{
+  BOOST_ASSERT(m_refCounts[id] > 0);
+
+  if (--m_refCounts[id] > 0)
+    return;
+
+  m_index.erase(m_hashes[id], id);
+  m_names[id] = Name();
+  m_freeIds.push_back(id);
+}
+
+
+std::ostream&
+operator<<(std::ostream& os, const FlatLeafRef& leaf)
+{
+  os << leaf.getSessionName() << "(" << leaf.getSeq() << ")";
+  return os;
+}
+
+
+FlatLeafContainer::FlatLeafContainer()
+{
+}
+
+FlatLeafContainer::FlatLeafContainer(const FlatLeafContainer& other)
+  : m_ids(other.m_ids)
+  , m_seqs(other.m_seqs)
+  , m_digests(other.m_digests)
+  , m_order(other.m_order)
+  , m_index(other.m_index)
+{
+  SessionNameTable& names = SessionNameTable::getInstance();
+  for (std::vector<uint32_t>::const_iterator it = m_ids.begin(); it != m_ids.end(); ++it)
+    names.addRef(*it);
+}
+
+FlatLeafContainer&
+FlatLeafContainer::operator=(const FlatLeafContainer& other)
+{
+  if (this != &other) {
+    // Take the new references before giving back the old ones, which may
+    // be the same names
+    SessionNameTable& names = SessionNameTable::getInstance();
+    for (std::vector<uint32_t>::const_iterator it = other.m_ids.begin();
+         it != other.m_ids.end(); ++it)
+      names.addRef(*it);
+
+    releaseNames();
+    m_ids = other.m_ids;
+    m_seqs = other.m_seqs;
+    m_digests = other.m_digests;
+    m_order = other.m_order;
+    m_index = other.m_index;
+  }
+  return *this;
+}
+
+FlatLeafContainer::~FlatLeafContainer()
+{
+  releaseNames();
+}
+
+FlatLeafContainer::const_iterator
+FlatLeafContainer::find(const SessionKey& key) const
+{
+  const SessionNameTable& names = SessionNameTable::getInstance();
+  uint32_t index =
+    m_index.find(key.hash,
+                 [&] (uint32_t candidate) { return names.getName(m_ids[candidate]) == key.name; });
+
+  if (index == FlatHashIndex::NPOS)
+    return end();
+  return const_iterator(this, index, false);
+}
+
+FlatLeafContainer::const_iterator
+FlatLeafContainer::addLeaf(const SessionKey& key, const SeqNo& seq)
+{
+  SessionNameTable& names = SessionNameTable::getInstance();
+  uint32_t id = names.intern(key);
+
+  uint32_t index = static_cast<uint32_t>(m_ids.size());
+  m_ids.push_back(id);
+  m_seqs.push_back(seq);
+  m_digests.push_back(Digest());
+  m_index.insert(key.hash, index);
+
+  // Leaves usually arrive in name order (e.g., decoding a state), so check
+  // the end of the order before searching for the insertion point
+  std::vector<uint32_t>::iterator position = m_order.end();
+  if (!m_order.empty() && key.name < names.getName(m_ids[m_order.back()])) {
+    position = std::lower_bound(m_order.begin(), m_order.end(), key.name,
+                                [&] (uint32_t leaf, const Name& name) {
+                                  return names.getName(m_ids[leaf]) < name;
+                                });
+  }
+  m_order.insert(position, index);
+
+  updateDigest(index);
+  return const_iterator(this, index, false);
+}
+
+void
+FlatLeafContainer::setLeafSeq(const_iterator leaf, const SeqNo& seq)
+{
+  size_t index = leaf.getIndex();
+  m_seqs[index] = seq;
+  updateDigest(index);
+}
+
+void
+FlatLeafContainer::clear()
+{
+  releaseNames();
+  m_ids.clear();
+  m_seqs.clear();
+  m_digests.clear();
+  m_order.clear();
+  m_index.clear();
+}
+
+void
+FlatLeafContainer::releaseNames()
+{
+  SessionNameTable& names = SessionNameTable::getInstance();
+  for (std::vector<uint32_t>::const_iterator it = m_ids.begin(); it != m_ids.end(); ++it)
+    names.release(*it);
+}
+
+void
+FlatLeafContainer::updateDigest(size_t index)
+{
+  computeLeafDigest(SessionNameTable::getInstance().getName(m_ids[index]),
+                    m_seqs[index], m_digests[index]);
+}
+
+} // namespace chronosync
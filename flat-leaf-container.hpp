@@ -0,0 +1,440 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_FLAT_LEAF_CONTAINER_HPP
+#define CHRONOSYNC_FLAT_LEAF_CONTAINER_HPP
+
+#include "mi-tag.hpp"
+#include "leaf.hpp"
+
+#include <boost/iterator/iterator_facade.hpp>
+
+namespace chronosync {
+
+/**
+ * @brief Open addressing (linear probing) index from a 64-bit hash to a 32-bit id
+ *
+ * The index does not know the indexed elements: lookups are given a predicate
+ * that tells whether the element with a candidate id is the one searched.
+ * The load factor is kept between 1/4 and 1/2, so the number of slots is
+ * O(n).  Ids must stay valid while they are indexed.
+ */
+class FlatHashIndex
+{
+public:
+  static const uint32_t NPOS;
+
+  FlatHashIndex();
+
+  template<typename Match>
+  uint32_t
+  find(uint64_t hash, const Match& match) const
+  {
+    if (m_slots.empty())
+      return NPOS;
+
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = static_cast<size_t>(hash) & mask; ; i = (i + 1) & mask) {
+      const Slot& slot = m_slots[i];
+      if (slot.id == NPOS)
+        return NPOS;
+      if (slot.hash == hash && match(slot.id))
+        return slot.id;
+    }
+  }
+
+  void
+  insert(uint64_t hash, uint32_t id);
+
+  /**
+   * @brief Remove the entry of @p id, indexed with @p hash
+   */
+  void
+  erase(uint64_t hash, uint32_t id);
+
+  void
+  clear();
+
+private:
+  void
+  grow();
+
+private:
+  struct Slot
+  {
+    uint64_t hash;
+    uint32_t id;
+  };
+
+  std::vector<Slot> m_slots;
+  size_t m_size;
+};
+
+/**
+ * @brief Process-wide table of interned session names
+ *
+ * Every session name stored in a FlatLeafContainer is kept once in this table
+ * and referred to by a 32-bit id.  Entries are reference counted by the
+ * containers holding them: a name is removed, and its id reused, when the
+ * last leaf with it goes away.
+ */
+class SessionNameTable : noncopyable
+{
+public:
+  static SessionNameTable&
+  getInstance();
+
+  /**
+   * @brief Get the id of a session name, adding it to the table if needed
+   *
+   * The caller holds a reference to the entry, to be given back with release().
+   */
+  uint32_t
+  intern(const SessionKey& key);
+
+  /**
+   * @brief Take another reference to an interned name
+   */
+  void
+  addRef(uint32_t id)
+  {
+    ++m_refCounts[id];
+  }
+
+  /**
+   * @brief Give back a reference, removing the name after the last one
+   */
+  void
+  release(uint32_t id);
+
+  const Name&
+  getName(uint32_t id) const
+  {
+    return m_names[id];
+  }
+
+  uint64_t
+  getHash(uint32_t id) const
+  {
+    return m_hashes[id];
+  }
+
+  /**
+   * @brief Get the number of names in the table
+   */
+  size_t
+  size() const
+  {
+    return m_names.size() - m_freeIds.size();
+  }
+
+private:
+  SessionNameTable();
+
+private:
+  std::vector<Name> m_names;
+  std::vector<uint64_t> m_hashes;
+  std::vector<uint32_t> m_refCounts;
+  // Ids of removed names, reused first
+  std::vector<uint32_t> m_freeIds;
+  FlatHashIndex m_index;
+};
+
+class FlatLeafContainer;
+
+/**
+ * @brief Read-only view of a leaf stored in a FlatLeafContainer
+ *
+ * It offers the same accessors as Leaf, and can be used with the same
+ * syntax as a ConstLeafPtr (leaf->getSeq(), os << *leaf).
+ */
+class FlatLeafRef
+{
+public:
+  FlatLeafRef(const FlatLeafContainer* container, size_t index)
+    : m_container(container)
+    , m_index(index)
+  {
+  }
+
+  const Name&
+  getSessionName() const;
+
+  uint64_t
+  getSessionHash() const;
+
+  SessionKey
+  getSessionKey() const
+  {
+    return SessionKey(getSessionName(), getSessionHash());
+  }
+
+  const SeqNo&
+  getSeq() const;
+
+  const Digest&
+  getDigest() const;
+
+  const FlatLeafRef*
+  operator->() const
+  {
+    return this;
+  }
+
+  const FlatLeafRef&
+  operator*() const
+  {
+    return *this;
+  }
+
+private:
+  const FlatLeafContainer* m_container;
+  size_t m_index;
+};
+
+std::ostream&
+operator<<(std::ostream& os, const FlatLeafRef& leaf);
+
+/**
+ * @brief Flat container for chronosync leaves
+ *
+ * Leaves are stored in insertion order in a structure of arrays (interned
+ * name ids, sequence numbers and leaf digests stored contiguously), so the
+ * index of a leaf in the arrays never changes.  An open addressing index
+ * over the session hash maps to these indexes, and a vector of indexes
+ * sorted by session name gives the iteration order.  Iteration is always in
+ * session name order, so get<ordered>() and get<hashed>() are the container
+ * itself.
+ *
+ * Inserting a leaf in the middle of the name order shifts the vector of
+ * indexes (a memmove of 32-bit values); the arrays and the hash index are
+ * only appended to.  Appending in name order (e.g., when decoding a state)
+ * costs O(1).  Updating a sequence number is O(1).
+ *
+ * This container is used as LeafContainer when CHRONOSYNC_FLAT_LEAF_CONTAINER
+ * is defined.
+ */
+class FlatLeafContainer
+{
+public:
+  /**
+   * @brief Iterator over the leaves
+   *
+   * Iterators got from begin() and end() go through the leaves in session
+   * name order.  Those returned by find() and addLeaf() go through them in
+   * insertion order, like the iterators of a hashed index.  Iterators that
+   * refer to the same leaf, or are both past the end, compare equal.
+   */
+  class const_iterator : public boost::iterator_facade<const_iterator,
+                                                       FlatLeafRef,
+                                                       boost::random_access_traversal_tag,
+                                                       FlatLeafRef>
+  {
+  public:
+    const_iterator()
+      : m_container(0)
+      , m_position(0)
+      , m_isOrdered(false)
+    {
+    }
+
+    const_iterator(const FlatLeafContainer* container, size_t position, bool isOrdered)
+      : m_container(container)
+      , m_position(position)
+      , m_isOrdered(isOrdered)
+    {
+    }
+
+    /**
+     * @brief Get the index of the leaf in the arrays of the container
+     *
+     * @return the index, or the size of the container past the end
+     */
+    size_t
+    getIndex() const;
+
+  private:
+    friend class boost::iterator_core_access;
+
+    FlatLeafRef
+    dereference() const
+    {
+      return FlatLeafRef(m_container, getIndex());
+    }
+
+    bool
+    equal(const const_iterator& other) const
+    {
+      return getIndex() == other.getIndex();
+    }
+
+    void
+    increment()
+    {
+      ++m_position;
+    }
+
+    void
+    decrement()
+    {
+      --m_position;
+    }
+
+    void
+    advance(std::ptrdiff_t n)
+    {
+      m_position += n;
+    }
+
+    std::ptrdiff_t
+    distance_to(const const_iterator& other) const
+    {
+      return static_cast<std::ptrdiff_t>(other.m_position) -
+             static_cast<std::ptrdiff_t>(m_position);
+    }
+
+  private:
+    const FlatLeafContainer* m_container;
+    // Position in the name order, or index in the arrays
+    size_t m_position;
+    bool m_isOrdered;
+  };
+
+  typedef const_iterator iterator;
+  typedef FlatLeafRef value_type;
+
+public:
+  FlatLeafContainer();
+
+  FlatLeafContainer(const FlatLeafContainer& other);
+
+  FlatLeafContainer&
+  operator=(const FlatLeafContainer& other);
+
+  ~FlatLeafContainer();
+
+  const_iterator
+  begin() const
+  {
+    return const_iterator(this, 0, true);
+  }
+
+  const_iterator
+  end() const
+  {
+    return const_iterator(this, m_ids.size(), true);
+  }
+
+  size_t
+  size() const
+  {
+    return m_ids.size();
+  }
+
+  bool
+  empty() const
+  {
+    return m_ids.empty();
+  }
+
+  template<typename Tag>
+  const FlatLeafContainer&
+  get() const
+  {
+    return *this;
+  }
+
+  const_iterator
+  find(const SessionKey& key) const;
+
+  /**
+   * @brief Insert a leaf that is not in the container yet
+   *
+   * @return iterator to the new leaf
+   */
+  const_iterator
+  addLeaf(const SessionKey& key, const SeqNo& seq);
+
+  /**
+   * @brief Set the sequence number of a leaf and recompute its digest
+   */
+  void
+  setLeafSeq(const_iterator leaf, const SeqNo& seq);
+
+  void
+  clear();
+
+private:
+  void
+  updateDigest(size_t index);
+
+  /// @brief Give back the references to the names of the leaves
+  void
+  releaseNames();
+
+private:
+  friend class FlatLeafRef;
+
+  std::vector<uint32_t> m_ids;
+  std::vector<SeqNo> m_seqs;
+  std::vector<Digest> m_digests;
+  // Indexes of the leaves sorted by session name
+  std::vector<uint32_t> m_order;
+
+  FlatHashIndex m_index;
+};
+
+inline size_t
+FlatLeafContainer::const_iterator::getIndex() const
+{
+  if (m_position >= m_container->m_ids.size())
+    return m_container->m_ids.size();
+  return m_isOrdered ? m_container->m_order[m_position] : m_position;
+}
+
+inline const Name&
+FlatLeafRef::getSessionName() const
+{
+  return SessionNameTable::getInstance().getName(m_container->m_ids[m_index]);
+}
+
+inline uint64_t
+FlatLeafRef::getSessionHash() const
+{
+  return SessionNameTable::getInstance().getHash(m_container->m_ids[m_index]);
+}
+
+inline const SeqNo&
+FlatLeafRef::getSeq() const
+{
+  return m_container->m_seqs[m_index];
+}
+
+inline const Digest&
+FlatLeafRef::getDigest() const
+{
+  return m_container->m_digests[m_index];
+}
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_FLAT_LEAF_CONTAINER_HPP
@@ -0,0 +1,281 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "iblt.hpp"
+
+namespace chronosync {
+
+const size_t Iblt::N_HASHES(3);
+
+// Sender chosen sizes above this are refused, a table of MAX_CELLS cells
+// is 112 KB
+const size_t Iblt::MAX_CELLS(4096);
+
+// count (4 bytes), keySum, seqSum and hashSum (8 bytes each)
+static const size_t CELL_SIZE = 28;
+
+/// @brief 64-bit mixing function (the splitmix64 finalizer)
+static uint64_t
+mix(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+static uint64_t
+entryKey(uint64_t sessionHash, uint64_t seq)
+{
+  return mix(sessionHash ^ mix(seq + 0x9e3779b97f4a7c15ULL));
+}
+
+/// @brief Hash stored in hashSum, to tell a pure cell from a sum of entries
+static uint64_t
+checkHash(uint64_t sessionHash, uint64_t seq)
+{
+  return mix(entryKey(sessionHash, seq) + 1);
+}
+
+static void
+putUint32(uint8_t* buffer, uint32_t value)
+{
+  for (int i = 3; i >= 0; --i, value >>= 8)
+    buffer[i] = static_cast<uint8_t>(value);
+}
+
+static void
+putUint64(uint8_t* buffer, uint64_t value)
+{
+  for (int i = 7; i >= 0; --i, value >>= 8)
+    buffer[i] = static_cast<uint8_t>(value);
+}
+
+static uint32_t
+getUint32(const uint8_t* buffer)
+{
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i)
+    value = (value << 8) | buffer[i];
+  return value;
+}
+
+static uint64_t
+getUint64(const uint8_t* buffer)
+{
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i)
+    value = (value << 8) | buffer[i];
+  return value;
+}
+
+Iblt::Iblt(size_t nCells)
+{
+  nCells = std::max(nCells, N_HASHES);
+  m_cells.resize((nCells + N_HASHES - 1) / N_HASHES * N_HASHES, Cell());
+}
+
+Iblt::Iblt(size_t nCells, const State& state)
+  : Iblt(nCells)
+{
+  BOOST_FOREACH (ConstLeafRef leaf, state.getLeaves())
+    {
+      insert(leaf->getSessionKey().hash, leaf->getSeq());
+    }
+}
+
+Iblt::Iblt(const Block& wire)
+{
+  wireDecode(wire);
+}
+
+void
+Iblt::insert(uint64_t sessionHash, const SeqNo& seq)
+{
+  update(m_cells, 1, sessionHash, seq);
+  m_wire.reset();
+}
+
+void
+Iblt::erase(uint64_t sessionHash, const SeqNo& seq)
+{
+  update(m_cells, -1, sessionHash, seq);
+  m_wire.reset();
+}
+
+void
+Iblt::update(std::vector<Cell>& cells, int32_t count, uint64_t sessionHash, uint64_t seq)
+{
+  uint64_t key = entryKey(sessionHash, seq);
+  uint64_t hash = checkHash(sessionHash, seq);
+  size_t subTableSize = cells.size() / N_HASHES;
+
+  for (size_t i = 0; i < N_HASHES; ++i) {
+    Cell& cell = cells[i * subTableSize + mix(key + i) % subTableSize];
+    cell.count += count;
+    cell.keySum ^= sessionHash;
+    cell.seqSum ^= seq;
+    cell.hashSum ^= hash;
+  }
+}
+
+bool
+Iblt::isPure(const Cell& cell)
+{
+  return (cell.count == 1 || cell.count == -1) &&
+         cell.hashSum == checkHash(cell.keySum, cell.seqSum);
+}
+
+Iblt&
+Iblt::operator-=(const Iblt& other)
+{
+  if (other.m_cells.size() != m_cells.size())
+    throw Error("Cannot subtract IBLTs of " + boost::lexical_cast<std::string>(other.m_cells.size()) +
+                " and " + boost::lexical_cast<std::string>(m_cells.size()) + " cells");
+
+  for (size_t i = 0; i < m_cells.size(); ++i) {
+    m_cells[i].count -= other.m_cells[i].count;
+    m_cells[i].keySum ^= other.m_cells[i].keySum;
+    m_cells[i].seqSum ^= other.m_cells[i].seqSum;
+    m_cells[i].hashSum ^= other.m_cells[i].hashSum;
+  }
+
+  m_wire.reset();
+  return *this;
+}
+
+bool
+Iblt::listEntries(std::vector<Entry>& positive, std::vector<Entry>& negative) const
+{
+  std::vector<Cell> cells = m_cells;
+
+  // Peel pure cells until there are none left
+  std::vector<size_t> candidates;
+  for (size_t i = 0; i < cells.size(); ++i) {
+    if (isPure(cells[i]))
+      candidates.push_back(i);
+  }
+
+  while (!candidates.empty()) {
+    Cell cell = cells[candidates.back()];
+    candidates.pop_back();
+
+    // It may have been peeled through another cell in the meantime
+    if (!isPure(cell))
+      continue;
+
+    Entry entry = {cell.keySum, cell.seqSum};
+    if (cell.count > 0)
+      positive.push_back(entry);
+    else
+      negative.push_back(entry);
+
+    uint64_t key = entryKey(cell.keySum, cell.seqSum);
+    size_t subTableSize = cells.size() / N_HASHES;
+    update(cells, -cell.count, cell.keySum, cell.seqSum);
+
+    for (size_t i = 0; i < N_HASHES; ++i) {
+      size_t index = i * subTableSize + mix(key + i) % subTableSize;
+      if (isPure(cells[index]))
+        candidates.push_back(index);
+    }
+  }
+
+  for (size_t i = 0; i < cells.size(); ++i) {
+    if (cells[i].count != 0 || cells[i].keySum != 0 ||
+        cells[i].seqSum != 0 || cells[i].hashSum != 0)
+      return false;
+  }
+
+  return true;
+}
+
+template<bool T>
+size_t
+Iblt::wireEncode(ndn::EncodingImpl<T>& block) const
+{
+  std::vector<uint8_t> buffer(m_cells.size() * CELL_SIZE);
+
+  for (size_t i = 0; i < m_cells.size(); ++i) {
+    uint8_t* cell = &buffer[i * CELL_SIZE];
+    putUint32(cell, static_cast<uint32_t>(m_cells[i].count));
+    putUint64(cell + 4, m_cells[i].keySum);
+    putUint64(cell + 12, m_cells[i].seqSum);
+    putUint64(cell + 20, m_cells[i].hashSum);
+  }
+
+  return prependByteArrayBlock(block, tlv::Iblt, buffer.data(), buffer.size());
+}
+
+template size_t
+Iblt::wireEncode<true>(ndn::EncodingImpl<true>& block) const;
+
+template size_t
+Iblt::wireEncode<false>(ndn::EncodingImpl<false>& block) const;
+
+const Block&
+Iblt::wireEncode() const
+{
+  if (m_wire.hasWire())
+    return m_wire;
+
+  ndn::EncodingEstimator estimator;
+  size_t estimatedSize = wireEncode(estimator);
+
+  ndn::EncodingBuffer buffer(estimatedSize, 0);
+  wireEncode(buffer);
+
+  m_wire = buffer.block();
+  return m_wire;
+}
+
+void
+Iblt::wireDecode(const Block& wire)
+{
+  if (!wire.hasWire())
+    throw Error("The supplied block does not contain wire format");
+
+  if (wire.type() != tlv::Iblt)
+    throw Error("Unexpected TLV type when decoding Iblt: " +
+                boost::lexical_cast<std::string>(wire.type()));
+
+  size_t nCells = wire.value_size() / CELL_SIZE;
+  if (wire.value_size() % CELL_SIZE != 0 || nCells == 0 ||
+      nCells % N_HASHES != 0 || nCells > MAX_CELLS)
+    throw Error("Invalid Iblt size: " + boost::lexical_cast<std::string>(wire.value_size()));
+
+  m_cells.resize(nCells);
+  const uint8_t* value = wire.value();
+  for (size_t i = 0; i < nCells; ++i) {
+    const uint8_t* cell = value + i * CELL_SIZE;
+    m_cells[i].count = static_cast<int32_t>(getUint32(cell));
+    m_cells[i].keySum = getUint64(cell + 4);
+    m_cells[i].seqSum = getUint64(cell + 12);
+    m_cells[i].hashSum = getUint64(cell + 20);
+  }
+
+  m_wire = wire;
+}
+
+} // namespace chronosync
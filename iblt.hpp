@@ -0,0 +1,153 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_IBLT_HPP
+#define CHRONOSYNC_IBLT_HPP
+
+#include "state.hpp"
+
+namespace chronosync {
+
+/**
+ * @brief Invertible Bloom lookup table over state leaves
+ *
+ * Each leaf is inserted as the pair (session hash, seqNo).  Subtracting the
+ * table of another state built with the same number of cells leaves only the
+ * leaves that differ between both states, which listEntries() recovers as
+ * long as there are not many more of them than about 2/3 of the cells.
+ *
+ * The table is split in N_HASHES sub-tables, and a leaf is added to one cell
+ * of each sub-table.
+ */
+class Iblt
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  /// @brief A leaf of the table: session hash and seqNo
+  struct Entry
+  {
+    uint64_t sessionHash;
+    SeqNo seq;
+  };
+
+  static const size_t N_HASHES;
+
+  /// @brief Maximum number of cells accepted when decoding
+  static const size_t MAX_CELLS;
+
+  /**
+   * @brief Create an empty table
+   *
+   * @param nCells Number of cells, rounded up to a multiple of N_HASHES
+   */
+  explicit
+  Iblt(size_t nCells);
+
+  /**
+   * @brief Create a table with the leaves of @p state
+   */
+  Iblt(size_t nCells, const State& state);
+
+  /**
+   * @brief Decode a table from its wire format
+   *
+   * @throws Error if the block is not a valid table
+   */
+  explicit
+  Iblt(const Block& wire);
+
+  size_t
+  getNCells() const
+  {
+    return m_cells.size();
+  }
+
+  void
+  insert(uint64_t sessionHash, const SeqNo& seq);
+
+  void
+  erase(uint64_t sessionHash, const SeqNo& seq);
+
+  /**
+   * @brief Subtract @p other cell by cell
+   *
+   * @throws Error if the tables don't have the same number of cells
+   */
+  Iblt&
+  operator-=(const Iblt& other);
+
+  /**
+   * @brief List the entries of the table
+   *
+   * After A -= B, @p positive receives the leaves of A that are not in B and
+   * @p negative the leaves of B that are not in A.
+   *
+   * @return false if the table could not be completely decoded (the lists
+   *         are then incomplete)
+   */
+  bool
+  listEntries(std::vector<Entry>& positive, std::vector<Entry>& negative) const;
+
+  template<bool T>
+  size_t
+  wireEncode(ndn::EncodingImpl<T>& block) const;
+
+  const Block&
+  wireEncode() const;
+
+  void
+  wireDecode(const Block& wire);
+
+private:
+  struct Cell
+  {
+    int32_t count;
+    uint64_t keySum;
+    uint64_t seqSum;
+    uint64_t hashSum;
+  };
+
+  /// @brief Add @p count copies (possibly negative) of an entry to @p cells
+  static void
+  update(std::vector<Cell>& cells, int32_t count, uint64_t sessionHash, uint64_t seq);
+
+  static bool
+  isPure(const Cell& cell);
+
+private:
+  std::vector<Cell> m_cells;
+
+  mutable Block m_wire;
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_IBLT_HPP
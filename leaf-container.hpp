@@ -28,11 +28,25 @@
 #include "mi-tag.hpp"
 #include "leaf.hpp"
 
-#include <ndn-cxx/util/crypto.hpp>
+#ifdef CHRONOSYNC_FLAT_LEAF_CONTAINER
+
+#include "flat-leaf-container.hpp"
+
+namespace chronosync {
+
+typedef FlatLeafContainer LeafContainer;
+
+/// @brief What iterating a LeafContainer yields
+typedef FlatLeafRef ConstLeafRef;
+
+} // namespace chronosync
+
+#else // CHRONOSYNC_FLAT_LEAF_CONTAINER
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/identity.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 
 
@@ -41,26 +55,64 @@ namespace chronosync {
 
 namespace mi = boost::multi_index;
 
+/**
+ * @brief Hash of the hashed leaf index
+ *
+ * Leaves carry their session hash, and SessionKey lookups carry a precomputed
+ * one; only lookups by a plain Name hash the name.
+ */
 struct SessionNameHash
 {
   std::size_t
-  operator()(const Name& prefix) const
+  operator()(const Leaf& leaf) const
   {
-    ndn::ConstBufferPtr buffer =
-      ndn::crypto::sha256(prefix.wireEncode().wire(), prefix.wireEncode().size());
+    return static_cast<std::size_t>(leaf.getSessionHash());
+  }
 
-    BOOST_ASSERT(buffer->size() > sizeof(std::size_t));
+  std::size_t
+  operator()(const SessionKey& key) const
+  {
+    return static_cast<std::size_t>(key.hash);
+  }
 
-    return *reinterpret_cast<const std::size_t*>(buffer->buf());
+  std::size_t
+  operator()(const Name& prefix) const
+  {
+    return static_cast<std::size_t>(computeSessionHash(prefix));
   }
 };
 
 struct SessionNameEqual
 {
   bool
-  operator()(const Name& prefix1, const Name& prefix2) const
+  operator()(const Leaf& leaf1, const Leaf& leaf2) const
   {
-    return prefix1 == prefix2;
+    return leaf1.getSessionHash() == leaf2.getSessionHash() &&
+           leaf1.getSessionName() == leaf2.getSessionName();
+  }
+
+  bool
+  operator()(const SessionKey& key, const Leaf& leaf) const
+  {
+    return key.hash == leaf.getSessionHash() && key.name == leaf.getSessionName();
+  }
+
+  bool
+  operator()(const Leaf& leaf, const SessionKey& key) const
+  {
+    return (*this)(key, leaf);
+  }
+
+  bool
+  operator()(const Name& prefix, const Leaf& leaf) const
+  {
+    return prefix == leaf.getSessionName();
+  }
+
+  bool
+  operator()(const Leaf& leaf, const Name& prefix) const
+  {
+    return prefix == leaf.getSessionName();
   }
 };
 
@@ -73,16 +125,23 @@ struct SessionNameCompare : public std::less<Name>
   }
 };
 
+/// @brief What iterating a LeafContainer yields
+typedef ConstLeafPtr ConstLeafRef;
+
 /**
  * @brief Container for chronosync leaves
+ *
+ * State only uses find(), addLeaf(), setLeafSeq(), clear() and iteration
+ * (in any order or through get<ordered>()), which FlatLeafContainer also
+ * provides.  Define CHRONOSYNC_FLAT_LEAF_CONTAINER to use it instead.
  */
 struct LeafContainer : public mi::multi_index_container<
   LeafPtr,
   mi::indexed_by<
-    // For fast access to elements using SessionName
+    // For fast access to elements using SessionName (or SessionKey)
     mi::hashed_unique<
       mi::tag<hashed>,
-      mi::const_mem_fun<Leaf, const Name&, &Leaf::getSessionName>,
+      mi::identity<Leaf>,
       SessionNameHash,
       SessionNameEqual
       >,
@@ -95,8 +154,29 @@ struct LeafContainer : public mi::multi_index_container<
     >
   >
 {
+  /**
+   * @brief Insert a leaf that is not in the container yet
+   *
+   * @return iterator to the new leaf
+   */
+  iterator
+  addLeaf(const SessionKey& key, const SeqNo& seq)
+  {
+    return insert(make_shared<Leaf>(key, seq)).first;
+  }
+
+  /**
+   * @brief Set the sequence number of a leaf
+   */
+  void
+  setLeafSeq(iterator leaf, const SeqNo& seq)
+  {
+    modify(leaf, [&seq] (LeafPtr& value) { value->setSeq(seq); });
+  }
 };
 
 } // namespace chronosync
 
+#endif // CHRONOSYNC_FLAT_LEAF_CONTAINER
+
 #endif // CHRONOSYNC_LEAF_CONTAINER_HPP
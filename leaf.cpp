@@ -23,10 +23,64 @@
 
 #include "leaf.hpp"
 
+#include <ndn-cxx/security/cryptopp.hpp>
+
 namespace chronosync {
 
+uint64_t
+computeSessionHash(const Name& sessionName)
+{
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+
+  const Block& wire = sessionName.wireEncode();
+  const uint8_t* data = wire.wire();
+  size_t length = wire.size();
+
+  uint64_t h = length * m;
+
+  for (; length >= 8; data += 8, length -= 8) {
+    uint64_t k = 0;
+    for (int i = 7; i >= 0; --i)
+      k = (k << 8) | data[i];
+
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+
+    h ^= k;
+    h *= m;
+  }
+
+  if (length > 0) {
+    for (size_t i = length; i > 0; --i)
+      h ^= static_cast<uint64_t>(data[i - 1]) << (8 * (i - 1));
+    h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+
+  return h;
+}
+
+void
+computeLeafDigest(const Name& sessionName, const SeqNo& seq, Digest& digest)
+{
+  // Same bytes as ndn::util::Sha256 << wireEncode() << seq, without
+  // allocating a buffer for the result
+  const Block& wire = sessionName.wireEncode();
+
+  CryptoPP::SHA256 hash;
+  hash.Update(wire.wire(), wire.size());
+  hash.Update(reinterpret_cast<const uint8_t*>(&seq), sizeof(seq));
+  hash.Final(digest.data());
+}
+
 Leaf::Leaf(const Name& sessionName, const SeqNo& seq)
   : m_sessionName(sessionName)
+  , m_sessionHash(computeSessionHash(m_sessionName))
   , m_seq(seq)
 {
   updateDigest();
@@ -37,17 +91,20 @@ Leaf::Leaf(const Name& userPrefix, uint64_t session, const SeqNo& seq)
   , m_seq(seq)
 {
   m_sessionName.appendNumber(session);
+  m_sessionHash = computeSessionHash(m_sessionName);
   updateDigest();
 }
 
-Leaf::~Leaf()
+Leaf::Leaf(const SessionKey& key, const SeqNo& seq)
+  : m_sessionName(key.name)
+  , m_sessionHash(key.hash)
+  , m_seq(seq)
 {
+  updateDigest();
 }
 
-ndn::ConstBufferPtr
-Leaf::getDigest() const
+Leaf::~Leaf()
 {
-  return m_digest.computeDigest();
 }
 
 void
@@ -62,9 +119,7 @@ Leaf::setSeq(const SeqNo& seq)
 void
 Leaf::updateDigest()
 {
-  m_digest.reset();
-  m_digest << getSessionName().wireEncode() << getSeq();
-  m_digest.computeDigest();
+  computeLeafDigest(m_sessionName, m_seq, m_digest);
 }
 
 std::ostream&
@@ -25,13 +25,62 @@
 #ifndef CHRONOSYNC_LEAF_HPP
 #define CHRONOSYNC_LEAF_HPP
 
-#include "common-chronosync.hpp"
-#include <ndn-cxx/util/digest.hpp>
+#include "digest.hpp"
 
 namespace chronosync {
 
 typedef uint64_t SeqNo;
 
+/**
+ * @brief Compute the hash of a session name used by the hashed leaf index
+ *
+ * This is a non-cryptographic 64-bit hash (MurmurHash64A) of the TLV encoding
+ * of the name.  The result does not depend on the host byte order.
+ */
+uint64_t
+computeSessionHash(const Name& sessionName);
+
+/**
+ * @brief Compute the digest of a leaf: SHA-256 of the session name TLV followed
+ *        by the sequence number
+ *
+ * @param sessionName session name of the leaf
+ * @param seq         sequence number of the leaf
+ * @param digest      receives the digest
+ */
+void
+computeLeafDigest(const Name& sessionName, const SeqNo& seq, Digest& digest);
+
+/**
+ * @brief Session name with its precomputed hash, used as a lookup key
+ *
+ * A SessionKey is a non-owning view: it refers to the session name it was
+ * built from, so it is only valid for the duration of the call it is passed
+ * to, and must not be stored.  Callers that already know the hash, e.g. from
+ * Leaf::getSessionKey(), skip hashing.
+ */
+struct SessionKey
+{
+  /**
+   * @brief Hash @p sessionName, which must outlive the key
+   */
+  explicit
+  SessionKey(const Name& sessionName)
+    : name(sessionName)
+    , hash(computeSessionHash(sessionName))
+  {
+  }
+
+  SessionKey(const Name& sessionName, uint64_t sessionHash)
+    : name(sessionName)
+    , hash(sessionHash)
+  {
+  }
+
+  const Name& name;
+  uint64_t hash;
+};
+
 /**
  * @brief Sync tree leaf
  *
@@ -44,6 +93,8 @@ public:
 
   Leaf(const Name& userPrefix, uint64_t session, const SeqNo& seq);
 
+  Leaf(const SessionKey& key, const SeqNo& seq);
+
   virtual
   ~Leaf();
 
@@ -53,14 +104,33 @@ public:
     return m_sessionName;
   }
 
+  uint64_t
+  getSessionHash() const
+  {
+    return m_sessionHash;
+  }
+
+  SessionKey
+  getSessionKey() const
+  {
+    return SessionKey(m_sessionName, m_sessionHash);
+  }
+
   const SeqNo&
   getSeq() const
   {
     return m_seq;
   }
 
-  ndn::ConstBufferPtr
-  getDigest() const;
+  /**
+   * @brief Get the digest of the leaf, computed when the leaf is created or its
+   *        sequence number changes
+   */
+  const Digest&
+  getDigest() const
+  {
+    return m_digest;
+  }
 
   /**
    * @brief Update sequence number of the leaf
@@ -77,9 +147,10 @@ private:
 
 private:
   Name     m_sessionName;
+  uint64_t m_sessionHash;
   SeqNo    m_seq;
 
-  mutable ndn::util::Sha256 m_digest;
+  Digest   m_digest;
 };
 
 typedef shared_ptr<Leaf> LeafPtr;
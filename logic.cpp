@@ -29,6 +29,7 @@
 
 #include "data-content.hpp"
 #include "reco-data.hpp"
+#include "multi-round-content.hpp"
 
 #include <chrono>
 
@@ -45,13 +46,6 @@ namespace chronosync {
 using ndn::ConstBufferPtr;
 using ndn::EventId;
 
-const uint8_t EMPTY_DIGEST_VALUE[] = {
-  0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14,
-  0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
-  0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c,
-  0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55
-};
-
 #ifdef _DEBUG
 int Logic::m_instanceCounter = 0;
 
@@ -84,17 +78,20 @@ const time::milliseconds Logic::DEFAULT_DATA_INTEREST_LIFETIME(1000);
 const time::milliseconds Logic::DEFAULT_SYNC_INTEREST_LIFETIME(1000);
 const time::milliseconds Logic::DEFAULT_DATA_FRESHNESS(1000);
 
-const ndn::ConstBufferPtr Logic::EMPTY_DIGEST(new ndn::Buffer(EMPTY_DIGEST_VALUE, 32));
-
-// Name components: DATA, SYNC, RECO
+// Name components: DATA, SYNC, RECO, and CD after RECO
 const ndn::name::Component Logic::DATA_INTEREST_COMPONENT("DATA");
 const ndn::name::Component Logic::SYNC_INTEREST_COMPONENT("SYNC");
 const ndn::name::Component Logic::RECO_INTEREST_COMPONENT("RECO");
+const ndn::name::Component Logic::CUMULATIVE_INTEREST_COMPONENT("CD");
 
 // Delay to send Sync Interest (with the round digest), once
 // a Data for a round is received.
 const time::milliseconds Logic::DEFAULT_ROUND_DIGEST_DELAY(1000);
 
+// New data in pending rounds delays their Sync Interests, at most
+// MAX_ROUND_DIGEST_DELAY after the first of them was scheduled
+const time::milliseconds Logic::MAX_ROUND_DIGEST_DELAY(2*DEFAULT_ROUND_DIGEST_DELAY);
+
 // Delay to stabilize cumulative digests from the m_stableRound to
 // m_stabilizingRound
 const time::milliseconds Logic::DEFAULT_STABILIZE_CUMULATIVE_DIGEST_DELAY(5*DEFAULT_ROUND_DIGEST_DELAY);
@@ -130,6 +127,56 @@ const int Logic::MAX_DATA_INTEREST_TIMEOUTS(5);
 // Maximum number of retries to send Reco Interest
 const int Logic::MAX_RECO_INTEREST_TIMEOUTS(5);
 
+// Rounds older than m_stableRound - DEFAULT_ROUND_LOG_COMPACT_WINDOW
+// only keep our own data and the digests
+const RoundNo Logic::DEFAULT_ROUND_LOG_COMPACT_WINDOW(2 * MAX_ROUNDS_WITHOUT_RECOVERY);
+
+// Rounds older than m_stableRound - DEFAULT_ROUND_LOG_DROP_WINDOW
+// are removed from the round log
+const RoundNo Logic::DEFAULT_ROUND_LOG_DROP_WINDOW(1000);
+
+// With persistence enabled, write a new snapshot at a stabilization
+// when the write-ahead log is bigger than DEFAULT_SNAPSHOT_LOG_SIZE bytes
+const size_t Logic::DEFAULT_SNAPSHOT_LOG_SIZE(1024 * 1024);
+
+// Reco Data is split in segments of at most MAX_RECO_SEGMENT_SIZE bytes
+// of leaves, so that each segment fits in a Data packet
+const size_t Logic::MAX_RECO_SEGMENT_SIZE(4096);
+
+// Maximum number of Reco Interests for segments in flight to a user prefix
+const size_t Logic::DEFAULT_RECO_PIPELINE_WINDOW(8);
+
+// The segments built to answer a Reco Interest are kept
+// DEFAULT_RECO_SEGMENTS_LIFETIME to answer the Interests for the
+// other segments
+const time::milliseconds Logic::DEFAULT_RECO_SEGMENTS_LIFETIME(10000);
+
+// At most MAX_RECO_TRANSFERS Reco Data transfers are served at a time,
+// the first segment of a new one is not answered beyond that
+const size_t Logic::MAX_RECO_TRANSFERS(64);
+
+// Reco Interests carry an IBLT of DEFAULT_RECO_IBLT_CELLS cells (28 bytes
+// each) of our state. The responder can decode differences of up to about
+// 2/3 of this number of leaves, otherwise it sends its full state
+const size_t Logic::DEFAULT_RECO_IBLT_CELLS(96);
+
+// Missed rounds are fetched with range Data Interests of at most
+// MAX_DATA_INTEREST_RANGE rounds, answered with one Data per producer
+const RoundNo Logic::MAX_DATA_INTEREST_RANGE(16);
+
+// The reply to a range Data Interest carries at most MAX_DATA_RANGE_SIZE
+// bytes of rounds, so that it fits in a Data packet. The requester asks
+// again for the rounds left out
+const size_t Logic::MAX_DATA_RANGE_SIZE(4096);
+
+// A Sync Interest carries the round digests of the last
+// DEFAULT_SYNC_INTEREST_ROUNDS rounds
+const RoundNo Logic::DEFAULT_SYNC_INTEREST_ROUNDS(8);
+
+// Local updates are not coalesced by default: each one takes a round
+const time::milliseconds Logic::DEFAULT_PUBLISH_COALESCING_WINDOW(0);
+const size_t Logic::DEFAULT_PUBLISH_COALESCING_COUNT(64);
+
 Logic::Logic(ndn::Face& face,
              const Name& syncPrefix,
              const Name& defaultUserPrefix,
@@ -149,6 +196,11 @@ Logic::Logic(ndn::Face& face,
   , m_stableRound(0)
   , m_lastRecoveryRound(0)
   , m_recoveryDesired(false)
+  , m_roundLogCompactWindow(DEFAULT_ROUND_LOG_COMPACT_WINDOW)
+  , m_roundLogDropWindow(DEFAULT_ROUND_LOG_DROP_WINDOW)
+  , m_compactedRound(0)
+  , m_droppedRound(0)
+  , m_roundLogReclaimedBytes(0)
   , m_onUpdate(onUpdate)
   , m_scheduler(m_face.getIoService())
   , m_randomGenerator(static_cast<unsigned int>(std::time(0)))
@@ -161,8 +213,14 @@ Logic::Logic(ndn::Face& face,
   , m_defaultSigningId(defaultSigningId)
   , m_validator(validator)
   , m_keyChain(ns3::ndn::StackHelper::getKeyChain())
+  , m_signingPipeline(m_scheduler, m_keyChain)
+  , m_rttEstimator(dataInterestLifetime)
+  , m_publishCoalescingWindow(DEFAULT_PUBLISH_COALESCING_WINDOW)
+  , m_publishCoalescingCount(DEFAULT_PUBLISH_COALESCING_COUNT)
+  , m_pendingSeqUpdates(0)
   , m_numberDataInterestTimeouts(0)
-  , m_numberRecoInterestTimeouts(0)
+  , m_isSyncImmediate(false)
+  , m_nextRecoTransferId(m_randomGenerator() + 1)
 {
 
 
@@ -251,8 +309,6 @@ Logic::getSeqNo(Name prefix)
 void
 Logic::updateSeqNo(const SeqNo& seqNo, const Name &updatePrefix)
 {
-  Name prefix = m_defaultUserPrefix;
-
   std::cerr << std::chrono::system_clock::now().time_since_epoch() / std::chrono::milliseconds(1)  <<  \
     " " << std::endl;
 
@@ -264,22 +320,65 @@ Logic::updateSeqNo(const SeqNo& seqNo, const Name &updatePrefix)
   m_seqNo = seqNo;
   _LOG_DEBUG_ID("    updateSeqNo: m_seqNo " << m_seqNo);
 
+  // Without coalescing, every update is committed in its own round
+  if (m_publishCoalescingWindow == time::milliseconds::zero() ||
+      m_publishCoalescingCount <= 1) {
+    commitSeqNo();
+    return;
+  }
+
+  m_pendingSeqUpdates++;
+  if (m_pendingSeqUpdates >= m_publishCoalescingCount) {
+    m_scheduler.cancelEvent(m_commitSeqNoId);
+    commitSeqNo();
+  }
+  else if (m_pendingSeqUpdates == 1) {
+    m_commitSeqNoId =
+      m_scheduler.scheduleEvent(m_publishCoalescingWindow,
+                                bind(&Logic::commitSeqNo, this));
+  }
+
+  _LOG_DEBUG_ID("<< Logic::updateSeqNo");
+}
+
+void
+Logic::setPublishCoalescing(const time::milliseconds& window, size_t maxUpdates)
+{
+  m_publishCoalescingWindow = window;
+  m_publishCoalescingCount = maxUpdates;
+
+  // Commit what was waiting under the previous setting
+  if (m_pendingSeqUpdates != 0) {
+    m_scheduler.cancelEvent(m_commitSeqNoId);
+    commitSeqNo();
+  }
+}
+
+void
+Logic::commitSeqNo()
+{
+  _LOG_DEBUG_ID(">> Logic::commitSeqNo");
+  _LOG_DEBUG_ID("    m_seqNo: " << m_seqNo << " updates: " << m_pendingSeqUpdates);
+
+  Name prefix = m_defaultUserPrefix;
+  m_pendingSeqUpdates = 0;
+
   bool isInserted = false;
   bool isUpdated = false;
   SeqNo oldSeq;
-  boost::tie(isInserted, isUpdated, oldSeq) = m_state.update(m_sessionName,
-                                                             m_seqNo);
+  SessionKey session(m_sessionName);
+  boost::tie(isInserted, isUpdated, oldSeq) = m_state.update(session, m_seqNo);
 
   _LOG_DEBUG_ID("    Insert: " << std::boolalpha << isInserted);
   _LOG_DEBUG_ID("    Updated: " << std::boolalpha << isUpdated);
   if (isInserted || isUpdated) {
     DiffStatePtr commit = make_shared<DiffState>();
-    commit->update(m_sessionName, m_seqNo);
+    commit->update(session, m_seqNo);
 
     if (m_stableRound != 0) {
       DiffStateContainer::iterator stateIter = m_log.find(m_stableRound);
       if (stateIter != m_log.end())
-	commit->setCumulativeInfo(make_shared<CumulativeInfo>(make_pair(m_stableRound, (*stateIter)->getCumulativeDigest())));
+	commit->setCumulativeInfo(make_shared<CumulativeInfo>(std::make_pair(m_stableRound, (*stateIter)->getCumulativeDigest())));
     }
 
     updateDiffLog(commit, m_currentRound);
@@ -292,8 +391,7 @@ Logic::updateSeqNo(const SeqNo& seqNo, const Name &updatePrefix)
       _LOG_DEBUG_ID("    don't have to send SyncData to m_pendingDataInterest");
 
     // Send round digest so everybody knows we have produced new data
-    m_scheduler.scheduleEvent(ndn::time::seconds(0),
-			      bind(&Logic::sendSyncInterest, this, m_currentRound));
+    scheduleSyncInterest(m_currentRound, true);
 
     moveToNewCurrentRound(m_currentRound + 1);
 
@@ -304,22 +402,77 @@ Logic::updateSeqNo(const SeqNo& seqNo, const Name &updatePrefix)
 #ifdef _DEBUG
     printRoundLog();
 #endif
-  _LOG_DEBUG_ID("<< Logic::updateSeqNo");
-
   }
 
+  _LOG_DEBUG_ID("<< Logic::commitSeqNo");
 }
 
 ConstBufferPtr
 Logic::getRootDigest() const
 {
-  return m_state.getDigest();
+  return m_state.getDigest().toBuffer();
+}
+
+void
+Logic::enablePersistence(const std::string& directory)
+{
+  _LOG_DEBUG_ID(">> Logic::enablePersistence");
+
+  scoped_ptr<StateStore> store(new StateStore(directory));
+
+  // m_store is still NULL while restoring, so the replayed entries are not
+  // appended to the log again
+  bool isRestored = restoreFromStore(*store);
+  m_store.swap(store);
+
+  if (!isRestored) {
+    _LOG_DEBUG_ID("    new store, write snapshot of session " << m_sessionName);
+    writeSnapshot();
+    _LOG_DEBUG_ID("<< Logic::enablePersistence");
+    return;
+  }
+
+  _LOG_DEBUG_ID("    restored session " << m_sessionName << " seqNo=" << m_seqNo <<
+                " currentRound=" << m_currentRound << " stableRound=" << m_stableRound);
+
+  // Fetch what we may have missed in the unstable rounds, and fish in
+  // m_currentRound.  Later rounds will be fetched as soon as we know
+  // about their existence
+  RoundNo initRound = m_stableRound + 1;
+  if (m_currentRound > BACK_UNSTABLE_ROUNDS + initRound)
+    initRound = m_currentRound - BACK_UNSTABLE_ROUNDS;
+
+  for (RoundNo i = initRound; i < m_currentRound; i++)
+    m_scheduler.scheduleEvent(ndn::time::seconds(0),
+                              bind(&Logic::sendDataInterest, this, i, 1));
+
+  m_scheduler.cancelEvent(m_reexpressingDataInterestId);
+  m_reexpressingDataInterestId =
+    m_scheduler.scheduleEvent(ndn::time::seconds(0),
+                              bind(&Logic::sendDataInterest, this, m_currentRound, 1));
+
+  m_scheduler.cancelEvent(m_stabilizingCumulativeDigest);
+  m_stabilizingCumulativeDigest =
+    m_scheduler.scheduleEvent(DEFAULT_STABILIZE_CUMULATIVE_DIGEST_DELAY,
+                              bind(&Logic::setStableState, this));
+
+  _LOG_DEBUG_ID("<< Logic::enablePersistence");
+}
+
+void
+Logic::setRoundLogRetention(RoundNo compactWindow, RoundNo dropWindow)
+{
+  if (dropWindow < compactWindow)
+    throw Error("Round log drop window must not be lower than compact window");
+
+  m_roundLogCompactWindow = compactWindow;
+  m_roundLogDropWindow = dropWindow;
 }
 
 void
 Logic::printState(std::ostream& os) const
 {
-  BOOST_FOREACH(ConstLeafPtr leaf, m_state.getLeaves())
+  BOOST_FOREACH(ConstLeafRef leaf, m_state.getLeaves())
     {
       os << *leaf << "\n";
     }
@@ -327,9 +480,9 @@ Logic::printState(std::ostream& os) const
 
 
 void
-Logic::printState(std::ostream& os, State state) const
+Logic::printState(std::ostream& os, const State& state) const
 {
-  BOOST_FOREACH(ConstLeafPtr leaf, state.getLeaves())
+  BOOST_FOREACH(ConstLeafRef leaf, state.getLeaves())
     {
       os << *leaf << "\n";
     }
@@ -353,6 +506,10 @@ Logic::onDataAndSyncInterest(const Name& prefix, const Interest& interest)
     // data interest: includes roundNo
     processDataInterest(interest.shared_from_this());
   }
+  else if (DATA_INTEREST_COMPONENT == name.get(-3)) {
+    // range data interest: includes first and last roundNo
+    processDataRangeInterest(interest.shared_from_this());
+  }
   else if (SYNC_INTEREST_COMPONENT == name.get(-3)){
     // sync interest: includes roundNo and round digest
     processSyncInterest(interest.shared_from_this());
@@ -373,23 +530,36 @@ Logic::onDataRegisterFailed(const Name& prefix, const std::string& msg)
 }
 
 void
-Logic::onData(const Interest& interest, Data& data)
+Logic::onData(const Interest& interest, Data& data,
+              const time::steady_clock::time_point& sentTime)
 {
   _LOG_DEBUG_ID(">> Logic::onData");
   _LOG_DEBUG_ID("    name " << interest.getName());
 
+  if (sentTime != time::steady_clock::time_point())
+    m_rttEstimator.addMeasurement(m_syncPrefix, time::steady_clock::now() - sentTime);
+
 
   if (partitioned) {
     _LOG_DEBUG_ID("    Partitioned: dropping Data");
     return;
   }
 
-  if (static_cast<bool>(m_validator))
-    m_validator->validate(data,
-                          bind(&Logic::onDataValidated, this, _1),
-                          bind(&Logic::onDataValidationFailed, this, _1));
-  else
-    onDataValidated(data.shared_from_this());
+  // Data we have already processed (the implicit digest is in the
+  // exclude filter of its round) is dropped before validating and
+  // decoding it again
+  const Name& fullName = data.getFullName();
+  if (DATA_INTEREST_COMPONENT == fullName.get(-3)) {
+    DiffStateContainer::iterator stateIter = m_log.find(fullName.get(-2).toNumber());
+    if (stateIter != m_log.end() && (*stateIter)->isExcluded(fullName.get(-1))) {
+      _LOG_DEBUG_ID("    Duplicate Data, dropping it");
+      return;
+    }
+  }
+
+  m_merkleValidator.validate(data, m_validator,
+                             bind(&Logic::onDataValidated, this, _1),
+                             bind(&Logic::onDataValidationFailed, this, _1));
   _LOG_DEBUG_ID("<< Logic::onData");
 }
 
@@ -403,25 +573,25 @@ Logic::onSyncData(const Interest& interest, Data& data)
 }
 
 void
-Logic::onRecoData(const Interest& interest, Data& data)
+Logic::onRecoData(const Interest& interest, Data& data,
+                  const time::steady_clock::time_point& sentTime)
 {
   _LOG_DEBUG_ID(">> Logic::onRecoData");
   _LOG_DEBUG_ID("    name " << interest.getName());
 
+  if (sentTime != time::steady_clock::time_point())
+    m_rttEstimator.addMeasurement(getRecoUserPrefix(interest.getName().getPrefix(-1)),
+                                  time::steady_clock::now() - sentTime);
+
 
   if (partitioned) {
     _LOG_DEBUG_ID("    Partitioned: dropping Data");
     return;
   }
 
-  if (static_cast<bool>(m_validator)) {
-    m_validator->validate(data,
-                          bind(&Logic::onRecoDataValidated, this, _1),
-                          bind(&Logic::onRecoDataValidationFailed, this, _1));
-  }
-  else {
-    onRecoDataValidated(data.shared_from_this());
-  }
+  m_merkleValidator.validate(data, m_validator,
+                             bind(&Logic::onRecoDataValidated, this, _1),
+                             bind(&Logic::onRecoDataValidationFailed, this, _1));
 
 
   _LOG_DEBUG_ID("<< Logic::onRecoData");
@@ -442,7 +612,14 @@ Logic::onRecoInterest(const Name& prefix, const Interest& interest)
     return;
   }
 
-  if (RECO_INTEREST_COMPONENT == name.get(-1)){
+  // Cumulative Digest Interests: <userPrefix>/RECO/CD/<round>
+  if (name.size() == m_recoPrefix.size() + 2 &&
+      CUMULATIVE_INTEREST_COMPONENT == name.get(-2) &&
+      name.get(-1).isNumber()) {
+    processCumulativeDigestInterest(interest.shared_from_this());
+  }
+  // Reco Interests end with the segment number
+  else if (name.get(-1).isSegment() && !getRecoUserPrefix(name.getPrefix(-1)).empty()){
     processRecoInterest(interest.shared_from_this());
   }
 
@@ -465,23 +642,40 @@ Logic::onRecoInterestTimeout(const Interest& interest)
   _LOG_DEBUG_ID(">> Logic::onRecoInterestTimeout");
   _LOG_DEBUG_ID("    Interest: " << interest.getName());
 
-  Name nodePrefix = interest.getName().getPrefix(-1);
-  m_numberRecoInterestTimeouts++;
-  if (m_numberRecoInterestTimeouts >= MAX_RECO_INTEREST_TIMEOUTS) {
+  Name nodePrefix = getRecoUserPrefix(interest.getName().getPrefix(-1));
+  uint64_t segment = interest.getName().get(-1).toSegment();
+
+  std::map<Name, RecoFetch>::iterator fetchIter = m_recoFetches.find(nodePrefix);
+  if (fetchIter == m_recoFetches.end() ||
+      fetchIter->second.pendingSegments.count(segment) == 0) {
+    _LOG_DEBUG_ID("    Reco Data no longer wanted");
+    return;
+  }
+
+  RecoFetch& fetch = fetchIter->second;
+  fetch.timeouts++;
+  if (fetch.timeouts >= MAX_RECO_INTEREST_TIMEOUTS) {
     std::cerr << "onRecoInterestTimeout:: Max rec timeouts to " <<
                nodePrefix ;
-    m_numberRecoInterestTimeouts = 0;
     _LOG_DEBUG_ID("    Removing from m_pendingRecoveryPrefixes: " <<
                   nodePrefix);
     m_pendingRecoveryPrefixes.erase(nodePrefix);
+    m_recoFetches.erase(fetchIter);
 
-  } else {
+  } else if (!fetch.hasFinalSegment) {
     _LOG_DEBUG_ID("    Program another send Reco Interest to " <<
                   nodePrefix);
 
      m_scheduler.scheduleEvent
    	   (ndn::time::seconds(0),
 	    bind(&Logic::sendRecoInterest, this, nodePrefix));
+  } else {
+    _LOG_DEBUG_ID("    Program another send Reco Interest for segment " << segment <<
+                  " to " << nodePrefix);
+
+    m_scheduler.scheduleEvent
+      (ndn::time::seconds(0),
+       bind(&Logic::sendRecoSegmentInterest, this, nodePrefix, segment));
   }
 
   _LOG_DEBUG_ID("<< Logic::onRecoInterestTimeout");
@@ -496,7 +690,7 @@ Logic::onSyncInterestTimeout(const Interest& interest)
 }
 
 void
-Logic::onDataInterestTimeout(const Interest& interest, unsigned retries)
+Logic::onDataInterestTimeout(const Interest& interest, unsigned retries, bool isPastRound)
 {
   _LOG_DEBUG_ID(">> Logic::onDataInterestTimeout");
 
@@ -513,14 +707,17 @@ Logic::onDataInterestTimeout(const Interest& interest, unsigned retries)
   }
 
 
-  m_numberDataInterestTimeouts++;
+  // Interests of past rounds expire after the RTO, their timeouts don't
+  // tell that the other nodes have stopped producing
+  if (!isPastRound)
+    m_numberDataInterestTimeouts++;
   if (m_numberDataInterestTimeouts >= MAX_DATA_INTEREST_TO_CUMULATIVE_ONLY &&
       m_stableRound == m_currentRound-1) {
     _LOG_DEBUG_ID("    Program to send my cumulative digest for the round="
                   << m_stableRound);
     m_numberDataInterestTimeouts = 0;
 
-    ndn::ConstBufferPtr myCumulativeDigest = m_state.getDigest();
+    Digest myCumulativeDigest = m_state.getDigest();
 
     ndn::EventId eventId =
       m_scheduler.scheduleEvent
@@ -530,9 +727,7 @@ Logic::onDataInterestTimeout(const Interest& interest, unsigned retries)
 	    m_stableRound,
 	    myCumulativeDigest));
 
-    m_cumulativeDigestToEventId.insert
-      (std::pair<ndn::Buffer,
-       ndn::EventId>(*myCumulativeDigest, eventId));
+    m_cumulativeDigestToEventId.insert(std::make_pair(myCumulativeDigest, eventId));
   }
 
   // Retry if interest is being sent in a round < m_currentRound.
@@ -574,6 +769,9 @@ Logic::onDataValidated(const shared_ptr<const Data>& data)
   if (DATA_INTEREST_COMPONENT == name.get(-3)) {
     processData(name, data->getContent().blockFromValue());
   }
+  else if (DATA_INTEREST_COMPONENT == name.get(-4)) {
+    processDataRange(name, data->getContent().blockFromValue());
+  }
   else
      std::cerr << ">>>    Logic::onDataValidated:: ERROR: DATA_INTEREST_COMPONENT != name.get(-3)";
 
@@ -586,11 +784,19 @@ Logic::onRecoDataValidated(const shared_ptr<const Data>& data)
   //_LOG_DEBUG_ID(">> Logic::onRecoDataValidated");
   Name name = data->getFullName();
 
-  if (RECO_INTEREST_COMPONENT == name.get(-2)){
-    processRecoData(name, data->getContent().blockFromValue());;
+  // Skip the implicit digest and the segment number
+  if (name.get(-2).isSegment() && !getRecoUserPrefix(name.getPrefix(-2)).empty()){
+    uint64_t segment = name.get(-2).toSegment();
+    const ndn::name::Component& finalBlockId = data->getFinalBlockId();
+    if (!finalBlockId.empty() && !finalBlockId.isSegment()) {
+      std::cerr << ">>>    Logic::onRecoDataValidated:: ERROR: bad FinalBlockId in " << name;
+      return;
+    }
+    uint64_t finalSegment = finalBlockId.empty() ? segment : finalBlockId.toSegment();
+    processRecoData(name, data->getContent().blockFromValue(), finalSegment);
   }
   else
-     std::cerr << ">>>    Logic::onRecoDataValidated:: ERROR: RECO_INTEREST_COMPONENT != name.get(-2)";
+     std::cerr << ">>>    Logic::onRecoDataValidated:: ERROR: not a Reco Data name " << name;
   //_LOG_DEBUG_ID("<< Logic::onRecoDataValidated");
 }
 
@@ -625,18 +831,29 @@ Logic::processDataInterest(const shared_ptr<const Interest>& interest)
   else if (roundNo < m_currentRound)  {
     // If we have something for that round, send it to him.
     DiffStateContainer::iterator stateIter = m_log.find(roundNo);
-    if (stateIter != m_log.end()) {
+    shared_ptr<const Data> data;
+    if (stateIter != m_log.end())
+      data = (*stateIter)->getSignedData(name);
+
+    if (data) {
+      // Past rounds don't change, so the Data signed for a previous
+      // Interest is still valid
+      _LOG_DEBUG_ID("    Sending cached Data for requested round");
+      m_face.put(*data);
+    }
+    else if (stateIter != m_log.end()) {
 
       // We only send data produced by this node. Either DataOnly,
       // DataAndCumulative, or CumulativeOnly. Other data produced in
       // this round by other nodes will be on caches or will be
       // retrieved from their producers
       bool isCumulativeOnly;
-      DiffStatePtr diffState = (*stateIter)->getStateFrom(m_sessionName, isCumulativeOnly);
+      DiffStatePtr diffState = (*stateIter)->getStateFrom(SessionKey(m_sessionName),
+                                                          isCumulativeOnly);
       if (diffState != NULL) {
         _LOG_DEBUG_ID("    We have something for requested round");
 #ifdef _DEBUG
-        printState(std::cerr, *(diffState->getState()));
+        printState(std::cerr, *diffState);
 #endif
 
 	CumulativeInfoPtr cumulativeInfo = diffState->getCumulativeInfo();
@@ -644,13 +861,14 @@ Logic::processDataInterest(const shared_ptr<const Interest>& interest)
           // CumulativeOnly entry in diffState
           if (cumulativeInfo) {
             _LOG_DEBUG_ID("    Help others with CumulativeInfo stored in my diffState");
-            sendCumulativeOnly(name, cumulativeInfo->first, cumulativeInfo->second);
+            sendCumulativeOnly(name, cumulativeInfo->first, cumulativeInfo->second,
+                               *stateIter);
           }
           else
             throw Error("Can't find cumulative in dataForCumulativeOnly");
         }
         else {
-          sendData(m_defaultUserPrefix, name, diffState);
+          sendData(m_defaultUserPrefix, name, diffState, *stateIter);
 	}
       }
       else
@@ -662,6 +880,84 @@ Logic::processDataInterest(const shared_ptr<const Interest>& interest)
 }
 
 
+void
+Logic::processDataRangeInterest(const shared_ptr<const Interest>& interest)
+{
+  _LOG_DEBUG_ID(">> Logic::processDataRangeInterest");
+  const Name& name = interest->getName();
+
+  _LOG_DEBUG_ID("    InterestName: " << name );
+
+  RoundNo from = name.get(-2).toNumber();
+  RoundNo to = name.get(-1).toNumber();
+
+  if (from > to || to - from >= MAX_DATA_INTEREST_RANGE) {
+    _LOG_DEBUG_ID("    Invalid range");
+    return;
+  }
+
+  // Our contribution to each round of the range, as processDataInterest
+  // would send it
+  MultiRoundContent multiRoundContent;
+  size_t contentSize = 0;
+  for (DiffStateContainer::iterator stateIter = m_log.lower_bound(from);
+       stateIter != m_log.end() && (*stateIter)->getRound() <= to &&
+       (*stateIter)->getRound() < m_currentRound;
+       ++stateIter) {
+    bool isCumulativeOnly;
+    DiffStatePtr diffState = (*stateIter)->getStateFrom(SessionKey(m_sessionName),
+                                                        isCumulativeOnly);
+    if (diffState == NULL)
+      continue;
+
+    CumulativeInfoPtr cumulativeInfo = diffState->getCumulativeInfo();
+    DataContentPtr dataContent;
+    if (isCumulativeOnly) {
+      if (cumulativeInfo)
+        dataContent = make_shared<DataContent>(m_sessionName, cumulativeInfo->first,
+                                               cumulativeInfo->second);
+    }
+    else if (cumulativeInfo)
+      dataContent = make_shared<DataContent>(m_sessionName, cumulativeInfo->first,
+                                             cumulativeInfo->second, diffState);
+    else
+      dataContent = make_shared<DataContent>(m_sessionName, 0, diffState);
+
+    if (!dataContent)
+      continue;
+
+    // Leave the remaining rounds for another Interest once the content
+    // is full, a round bigger than the limit is sent alone
+    size_t roundSize = dataContent->wireEncode().size();
+    if (!multiRoundContent.empty() && contentSize + roundSize > MAX_DATA_RANGE_SIZE) {
+      _LOG_DEBUG_ID("    Content full, next round " << (*stateIter)->getRound());
+      multiRoundContent.setNextRound((*stateIter)->getRound());
+      break;
+    }
+
+    multiRoundContent.addRound((*stateIter)->getRound(), dataContent);
+    contentSize += roundSize;
+  }
+
+  if (multiRoundContent.empty()) {
+    _LOG_DEBUG_ID("    We have NOTHING for requested rounds");
+    _LOG_DEBUG_ID("<< Logic::processDataRangeInterest");
+    return;
+  }
+
+  _LOG_DEBUG_ID("    Send " << multiRoundContent.getRounds().size() << " rounds");
+
+  shared_ptr<Data> data = make_shared<Data>(name);
+  data->setContent(multiRoundContent.wireEncode());
+  data->setFreshnessPeriod(m_dataFreshness);
+
+  m_signingPipeline.sign(data, m_defaultSigningId,
+                         bind(&Logic::onDataSigned, this, _1, DiffStatePtr(), DiffStatePtr()));
+
+  _LOG_DEBUG_ID("<< Logic::processDataRangeInterest");
+}
+
+
 void
 Logic::moveToNewCurrentRound (RoundNo newCurrentRound)
 {
@@ -670,11 +966,7 @@ Logic::moveToNewCurrentRound (RoundNo newCurrentRound)
   if(newCurrentRound - m_currentRound <= MAX_ROUNDS_WITHOUT_RECOVERY){
     // Data has been produced in rounds m_currentRound
     // .. newCurrentRound, so let's fetch it
-    for (auto i = m_currentRound; i<newCurrentRound; i++){
-      EventId eventId =
-        m_scheduler.scheduleEvent(ndn::time::seconds(0),
-                                  bind(&Logic::sendDataInterest, this, i, 1));
-    }
+    sendDataInterests(m_currentRound, newCurrentRound - 1);
   }
   else{
     // Too far away, don't fish. Once a data with different cumulative
@@ -764,6 +1056,11 @@ Logic::setStableState ()
   _LOG_DEBUG_ID("    new stabilizingRound = " << m_stabilizingRound);
   _LOG_DEBUG_ID("    current round: = " << m_currentRound);
 
+  collectRoundLog();
+
+  if (m_store && m_store->getLogSize() >= DEFAULT_SNAPSHOT_LOG_SIZE)
+    writeSnapshot();
+
   m_stabilizingCumulativeDigest =
     m_scheduler.scheduleEvent(DEFAULT_STABILIZE_CUMULATIVE_DIGEST_DELAY,
                               bind(&Logic::setStableState, this));
@@ -776,18 +1073,15 @@ Logic::calculateStableStateAndCumulativeDigests (RoundNo initRound, RoundNo endR
 {
   _LOG_DEBUG_ID(">> Logic::calculateStableStateAndCumulativeDigests");
 
-  DiffStateContainer::iterator stateIter = m_log.find(initRound);
-  RoundNo r = initRound;
-  while (stateIter == m_log.end() && r < endRound) {
-    _LOG_DEBUG_ID("      We dont have anything for the first round, go next one");
-    r++;
-    stateIter = m_log.find(r);
-  }
+  // Skip the rounds we don't have anything for
+  DiffStateContainer::iterator stateIter = m_log.lower_bound(initRound);
 
   while ((stateIter != m_log.end() &&
          (*stateIter)->getRound() < endRound)) {
     _LOG_DEBUG_ID("      Adding state of round = " << (*stateIter)->getRound());
-    m_oldState += *((*stateIter)->getState());
+    // Merge the leaves of the round in place, m_oldState keeps its root
+    // digest up to date in O(1) per changed leaf
+    m_oldState += **stateIter;
     (*stateIter)->setCumulativeDigest(m_oldState.getDigest());
     ++stateIter;
   }
@@ -800,69 +1094,227 @@ Logic::calculateStableStateAndCumulativeDigests (RoundNo initRound, RoundNo endR
   }
   else{
     commit = *stateIter;
-    m_oldState += *(commit->getState());
+    m_oldState += *commit;
   }
   _LOG_DEBUG_ID("      Added stable state of round = " << endRound);
   commit->setCumulativeDigest(m_oldState.getDigest());
 
+#ifdef _DEBUG
+  // Printing the whole stable state is O(N), keep it out of normal runs
   _LOG_DEBUG_ID("      Print stable state");
   printState(std::cerr, m_oldState);
+#endif
   printDigest(commit->getCumulativeDigest(), "cumulative digest of m_oldState");
 
   _LOG_DEBUG_ID("<< Logic::calculateStableStateAndCumulativeDigests");
 }
 
+size_t
+Logic::collectRoundLog ()
+{
+  _LOG_DEBUG_ID(">> Logic::collectRoundLog");
+
+  size_t reclaimed = 0;
+
+  // Drop rounds older than m_stableRound - m_roundLogDropWindow
+  if (m_stableRound > m_roundLogDropWindow) {
+    RoundNo dropBefore = m_stableRound - m_roundLogDropWindow;
+
+    DiffStateContainer::iterator stateIter = m_log.begin();
+    for (; stateIter != m_log.end() && (*stateIter)->getRound() < dropBefore; ++stateIter) {
+      reclaimed += (*stateIter)->getMemoryUsage();
+    }
+    m_log.eraseBefore(dropBefore);
+
+    m_droppedRound = std::max(m_droppedRound, dropBefore - 1);
+  }
+
+  // Compact rounds older than m_stableRound - m_roundLogCompactWindow
+  if (m_stableRound > m_roundLogCompactWindow) {
+    RoundNo compactBefore = m_stableRound - m_roundLogCompactWindow;
+    SessionKey ownSession(m_sessionName);
+
+    DiffStateContainer::iterator stateIter = m_log.upper_bound(m_compactedRound);
+    while (stateIter != m_log.end() && (*stateIter)->getRound() < compactBefore) {
+      reclaimed += (*stateIter)->compact(ownSession);
+      ++stateIter;
+    }
+
+    m_compactedRound = std::max(m_compactedRound, compactBefore - 1);
+  }
+
+  m_roundLogReclaimedBytes += reclaimed;
+
+  _LOG_DEBUG_ID("    reclaimed " << reclaimed << " bytes, " << m_log.size() <<
+                " rounds in log, dropped up to round " << m_droppedRound <<
+                ", compacted up to round " << m_compactedRound);
+  _LOG_DEBUG_ID("<< Logic::collectRoundLog");
+
+  return reclaimed;
+}
 
 bool
-Logic::checkRoundDigests (RoundNo roundNo, const ConstBufferPtr roundDigest)
+Logic::restoreFromStore (StateStore& store)
 {
-  _LOG_DEBUG_ID(">> Logic::checkRoundDigests");
+  _LOG_DEBUG_ID(">> Logic::restoreFromStore");
 
-  bool areEqual = false;
+  StateStore::SnapshotInfo info;
+  if (!store.loadSnapshot(info, m_oldState, m_state)) {
+    _LOG_DEBUG_ID("<< Logic::restoreFromStore");
+    return false;
+  }
 
+  std::vector<DiffStatePtr> entries = store.loadLog();
 
-  // Someone is sending digest interests in a previous round
+  m_sessionName = info.sessionName;
+  m_seqNo = info.seqNo;
+  m_currentRound = info.currentRound;
+  m_stableRound = info.stableRound;
+  m_lastRecoveryRound = info.lastRecoveryRound;
 
-  DiffStateContainer::iterator stateIter = m_log.find(roundNo);
+  // Rounds before the stable round are only in m_oldState
+  m_log.clear();
+  m_droppedRound = m_stableRound > 0 ? m_stableRound - 1 : 0;
+  m_compactedRound = m_droppedRound;
+
+  if (m_stableRound != 0) {
+    DiffStatePtr commit = make_shared<DiffState>();
+    updateDiffLog(commit, m_stableRound);
+    commit->setCumulativeDigest(info.stableCumulativeDigest);
+  }
 
+  // Replay the log as processData() and updateSeqNo() applied it
+  BOOST_FOREACH (const DiffStatePtr& entry, entries)
+    {
+      RoundNo roundNo = entry->getRound();
 
-  if (stateIter != m_log.end()) {
-    // We have data in round log for roundNo
-    ConstBufferPtr rd = (*stateIter)->getRoundDigest();
-    assert (rd);
-    _LOG_DEBUG("    Comparing round digest in round=" << roundNo);
-    printDigest(roundDigest, "received round digest");
-    printDigest(rd, "my round digest");
-
-    if (ndn::name::Component(roundDigest) != ndn::name::Component(rd)) {
-      _LOG_DEBUG_ID("    != round digests for round " << roundNo << ", go FISHING");
-      // Perhaps we are missing something in roundNo, so go fishing there
-      m_scheduler.scheduleEvent(ndn::time::seconds(0),
-                                bind(&Logic::sendDataInterest, this, roundNo, 1));
+      BOOST_FOREACH (ConstLeafRef leaf, entry->getLeaves())
+        {
+          if (leaf->getSeq() == CUMULATIVE_ONLY_DATA)
+            continue;
+
+          if (roundNo <= m_lastRecoveryRound && m_stableRound == 0)
+            m_oldState.update(leaf->getSessionKey(), leaf->getSeq());
+          m_state.update(leaf->getSessionKey(), leaf->getSeq());
+        }
+
+      if (roundNo <= m_stableRound)
+        continue;
 
-      // Send round digest in the future to inform of our final round digest
-      // in this round
-      _LOG_DEBUG_ID("    Program sending my Round Digest in round=" << roundNo);
-      EventId eventId =
-        m_scheduler.scheduleEvent(DEFAULT_ROUND_DIGEST_DELAY,
-                                  bind(&Logic::sendSyncInterest, this, roundNo));
-      m_scheduler.cancelEvent((*stateIter)->getReexpressingSyncInterestId());
-      (*stateIter)->setReexpressingSyncInterestId(eventId);
+      // Entries of a round already in the log are merged into it
+      updateDiffLog(entry, roundNo);
+
+      m_currentRound = std::max(m_currentRound, roundNo + 1);
     }
+
+  m_seqNo = std::max(m_seqNo, m_state.getSeqNo(SessionKey(m_sessionName)));
+
+  if (m_stableRound != 0)
+    m_stabilizingRound = m_stableRound + (m_currentRound - m_stableRound)/2;
+  else if (m_lastRecoveryRound != 0)
+    m_stabilizingRound = m_lastRecoveryRound;
+  else
+    m_stabilizingRound = 1;
+
+  _LOG_DEBUG_ID("<< Logic::restoreFromStore");
+  return true;
+}
+
+void
+Logic::writeSnapshot ()
+{
+  _LOG_DEBUG_ID(">> Logic::writeSnapshot");
+
+  StateStore::SnapshotInfo info;
+  info.sessionName = m_sessionName;
+  info.seqNo = m_seqNo;
+  info.currentRound = m_currentRound;
+  info.stableRound = m_stableRound;
+  info.lastRecoveryRound = m_lastRecoveryRound;
+
+  DiffStateContainer::iterator stateIter = m_log.find(m_stableRound);
+  if (m_stableRound != 0 && stateIter != m_log.end())
+    info.stableCumulativeDigest = (*stateIter)->getCumulativeDigest();
+
+  try {
+    m_store->writeSnapshot(info, m_oldState, m_state);
+
+    // The log only has to keep the rounds that are not in m_oldState
+    for (stateIter = m_log.upper_bound(m_stableRound); stateIter != m_log.end(); ++stateIter)
+      m_store->append(**stateIter);
+  }
+  catch (StateStore::Error& e) {
+    std::cerr << "    Logic::writeSnapshot:: ERROR: " << e.what() << ", persistence disabled" << std::endl;
+    m_store.reset();
+  }
+
+  _LOG_DEBUG_ID("<< Logic::writeSnapshot");
+}
+
+
+bool
+Logic::checkRoundDigests (RoundNo firstRound, const std::vector<Digest>& roundDigests)
+{
+  _LOG_DEBUG_ID(">> Logic::checkRoundDigests");
+
+  bool areEqual = true;
+
+  // Someone is sending digest interests in previous rounds. Rounds in
+  // which we are missing something are fetched together
+  RoundNo fishFrom = 0;
+
+  for (size_t i = 0; i < roundDigests.size(); ++i) {
+    RoundNo roundNo = firstRound + i;
+    bool isDifferent = true;
+
+    // roundNo <= m_lastRecoveryRound is too old, do nothing.
+    // We don't have reliable round digest after a recovery
+    if (roundNo <= m_lastRecoveryRound || roundNo >= m_currentRound)
+      isDifferent = false;
     else {
-      _LOG_DEBUG_ID("    EQUAL Round Digests!");
-      areEqual = true;
+      DiffStateContainer::iterator stateIter = m_log.find(roundNo);
+
+      if (stateIter != m_log.end()) {
+        // We have data in round log for roundNo
+        const Digest& rd = (*stateIter)->getRoundDigest();
+        _LOG_DEBUG("    Comparing round digest in round=" << roundNo);
+        printDigest(roundDigests[i], "received round digest");
+        printDigest(rd, "my round digest");
+
+        if (roundDigests[i] != rd) {
+          _LOG_DEBUG_ID("    != round digests for round " << roundNo << ", go FISHING");
+
+          // Send round digest in the future to inform of our final round digest
+          // in this round
+          _LOG_DEBUG_ID("    Program sending my Round Digest in round=" << roundNo);
+          scheduleSyncInterest(roundNo);
+        }
+        else {
+          _LOG_DEBUG_ID("    EQUAL Round Digests in round " << roundNo);
+          isDifferent = false;
+        }
+      }
+      else {
+        // We don't have data in round log for roundNo, it's sure that we
+        // are missing something in roundNo
+        _LOG_DEBUG_ID("    we have nothing for round " << roundNo << ", go FISHING");
+      }
     }
-  }
-  else {
-    // We don't have data in round log for roundNo
-    _LOG_DEBUG_ID("    we have nothing for round " << roundNo << ", go FISHING");
 
-    // It's sure that we are missing something in roundNo, so go fishing there
-    m_scheduler.scheduleEvent(ndn::time::seconds(0),
-                              bind(&Logic::sendDataInterest, this, roundNo, 1));
+    if (isDifferent) {
+      areEqual = false;
+      if (fishFrom == 0)
+        fishFrom = roundNo;
+    }
+    else if (fishFrom != 0) {
+      sendDataInterests(fishFrom, roundNo - 1);
+      fishFrom = 0;
+    }
   }
 
+  if (fishFrom != 0)
+    sendDataInterests(fishFrom, firstRound + roundDigests.size() - 1);
+
   _LOG_DEBUG_ID("<< Logic::checkRoundDigests");
 
   return areEqual;
@@ -872,7 +1324,7 @@ Logic::checkRoundDigests (RoundNo roundNo, const ConstBufferPtr roundDigest)
 
 
 void
-Logic::produceCumulativeOnly(RoundNo roundNo, ndn::ConstBufferPtr cumulativeDigest)
+Logic::produceCumulativeOnly(RoundNo roundNo, const Digest& cumulativeDigest)
 {
   // Send to pending interest, if it exists
   _LOG_DEBUG_ID(">> Logic::produceCumulativeOnly");
@@ -889,9 +1341,9 @@ Logic::produceCumulativeOnly(RoundNo roundNo, ndn::ConstBufferPtr cumulativeDige
   _LOG_DEBUG_ID("    store CumulativeOnly of round=" << roundNo << " in difflog");
   // Store in current round state
   DiffStatePtr commit = make_shared<DiffState>();
-  commit->update(m_sessionName, CUMULATIVE_ONLY_DATA);
+  commit->update(SessionKey(m_sessionName), CUMULATIVE_ONLY_DATA);
 
-  commit->setCumulativeInfo(make_shared<CumulativeInfo>(make_pair(roundNo, cumulativeDigest)));
+  commit->setCumulativeInfo(make_shared<CumulativeInfo>(std::make_pair(roundNo, cumulativeDigest)));
 
   updateDiffLog(commit, m_currentRound);
 
@@ -903,7 +1355,8 @@ Logic::produceCumulativeOnly(RoundNo roundNo, ndn::ConstBufferPtr cumulativeDige
 }
 
 void
-Logic::sendCumulativeOnly(ndn::Name name, RoundNo roundNo, ndn::ConstBufferPtr cumulativeDigest)
+Logic::sendCumulativeOnly(ndn::Name name, RoundNo roundNo, const Digest& cumulativeDigest,
+                          DiffStatePtr roundState)
 {
   _LOG_DEBUG_ID(">> Logic::sendCumulativeOnly");
 
@@ -918,23 +1371,14 @@ Logic::sendCumulativeOnly(ndn::Name name, RoundNo roundNo, ndn::ConstBufferPtr c
   cumulativeOnlyData->setContent(dataContent.wireEncode());
   cumulativeOnlyData->setFreshnessPeriod(m_dataFreshness);
 
-
-  if (m_defaultSigningId.empty())
-    m_keyChain.sign(*cumulativeOnlyData);
-  else
-    m_keyChain.signByIdentity(*cumulativeOnlyData, m_defaultSigningId);
-
-  // Update exclude filter in commit
-  _LOG_DEBUG_ID("    Update exclude filter with: " <<
-                cumulativeOnlyData->getFullName().get(-1));
-
+  // Exclude filter in commit is updated once the Data is signed
+  DiffStatePtr excludeState;
   DiffStateContainer::iterator stateIter = m_log.find(roundNo);
-  if (stateIter != m_log.end()) {
-    (*stateIter)->appendExclude(cumulativeOnlyData->getFullName().get(-1));
-  }
-
+  if (stateIter != m_log.end())
+    excludeState = *stateIter;
 
-  m_face.put(*cumulativeOnlyData);
+  m_signingPipeline.sign(cumulativeOnlyData, m_defaultSigningId,
+                         bind(&Logic::onDataSigned, this, _1, excludeState, roundState));
 
   // checking if our own interest got satisfied
   if (m_outstandingDataInterestName == name) {
@@ -965,24 +1409,90 @@ Logic::sendRecoInterest(ndn::Name userPrefix){
   interestName.append(userPrefix)
     .append(RECO_INTEREST_COMPONENT);
 
+  // Ask only for the changes after our stable round, if we have its
+  // cumulative digest. Cumulative digests before m_lastRecoveryRound
+  // aren't reliable
+  if (m_stableRound != 0 && m_stableRound >= m_lastRecoveryRound) {
+    DiffStateContainer::iterator stateIter = m_log.find(m_stableRound);
+    if (stateIter != m_log.end() && !(*stateIter)->getCumulativeDigest().isZero()) {
+      interestName.append(ndn::name::Component::fromNumber(m_stableRound))
+        .append((*stateIter)->getCumulativeDigest().toComponent());
+    }
+  }
+
+  // If the delta can't be sent, the responder reconciles with our state
+  Iblt iblt(DEFAULT_RECO_IBLT_CELLS, m_state);
+  const Block& ibltWire = iblt.wireEncode();
+  interestName.append(ndn::name::Component(ibltWire.wire(), ibltWire.size()));
+
+  // (Re)start the transfer, keeping the count of timeouts
+  RecoFetch& fetch = m_recoFetches[userPrefix];
+  fetch.name = interestName;
+  fetch.hasFinalSegment = false;
+  fetch.finalSegment = 0;
+  fetch.nextSegment = 1;
+  fetch.pendingSegments.clear();
+  fetch.roundNo = 0;
+
+  sendRecoSegmentInterest(userPrefix, 0);
+
+  _LOG_DEBUG_ID("<< Logic::sendRecoInterest");
+}
+
+void
+Logic::sendRecoSegmentInterests(const Name& userPrefix)
+{
+  std::map<Name, RecoFetch>::iterator fetchIter = m_recoFetches.find(userPrefix);
+  if (fetchIter == m_recoFetches.end())
+    return;
+
+  RecoFetch& fetch = fetchIter->second;
+  while (fetch.hasFinalSegment && fetch.nextSegment <= fetch.finalSegment &&
+         fetch.pendingSegments.size() < DEFAULT_RECO_PIPELINE_WINDOW) {
+    sendRecoSegmentInterest(userPrefix, fetch.nextSegment);
+    fetch.nextSegment++;
+  }
+}
+
+void
+Logic::sendRecoSegmentInterest(const Name& userPrefix, uint64_t segment)
+{
+  if (partitioned) {
+    _LOG_DEBUG_ID("    Partitioned: dropping Interest ");
+    return;
+  }
+
+  std::map<Name, RecoFetch>::iterator fetchIter = m_recoFetches.find(userPrefix);
+  if (fetchIter == m_recoFetches.end())
+    return;
+
+  RecoFetch& fetch = fetchIter->second;
+  fetch.pendingSegments.insert(segment);
+
+  Name interestName = fetch.name;
+  interestName.append(ndn::name::Component::fromSegment(segment));
+
   Interest interest(interestName);
   interest.setMustBeFresh(true);
-  interest.setInterestLifetime(m_syncInterestLifetime);
+  interest.setInterestLifetime(m_rttEstimator.getRto(userPrefix, fetch.timeouts + 1));
+
+  // Once a segment has timed out we can't tell which transmission a
+  // reply answers, so the transfer is no longer measured
+  time::steady_clock::time_point sentTime;
+  if (fetch.timeouts == 0)
+    sentTime = time::steady_clock::now();
 
   m_face.expressInterest(interest,
-                         bind(&Logic::onRecoData, this, _1, _2),
+                         bind(&Logic::onRecoData, this, _1, _2, sentTime),
                          bind(&Logic::onRecoInterestTimeout, this, _1));
 
-
-
   _LOG_DEBUG_ID("    Send recovery interest: " << interest.getName());
-  _LOG_DEBUG_ID("<< Logic::sendRecoInterest");
 }
 
 void
 Logic::checkRecovery(ndn::Name userPrefix,
                      RoundNo roundNoOfCumulativeDigest,
-                     ndn::ConstBufferPtr cumulativeDigest) {
+                     const Digest& cumulativeDigest) {
 
   _LOG_DEBUG_ID(">> Logic::checkRecovery");
   _LOG_DEBUG_ID("    Cumulative sent from=" << userPrefix << " cumulative round=" << roundNoOfCumulativeDigest);
@@ -991,24 +1501,33 @@ Logic::checkRecovery(ndn::Name userPrefix,
   // If this cumulative == the one we have scheduled to send in
   // m_cumulativeDigestToEventId, cancel it and delete entry
 
-  std::map<ndn::Buffer, ndn::EventId>::iterator it =
-    m_cumulativeDigestToEventId.find(*cumulativeDigest);
+  std::unordered_map<Digest, ndn::EventId, DigestHash>::iterator it =
+    m_cumulativeDigestToEventId.find(cumulativeDigest);
   if (it != m_cumulativeDigestToEventId.end()) {
     _LOG_DEBUG_ID("    Cancel event of sendng cumulative digest. I have received one that is equal to mine");
     ndn::EventId eventId = it->second;
     m_scheduler.cancelEvent(eventId);
-    m_cumulativeDigestToEventId.erase(*cumulativeDigest);
+    m_cumulativeDigestToEventId.erase(it);
 
     _LOG_DEBUG_ID("<< Logic::checkRecovery");
     return;
   }
 
 
-  ndn::ConstBufferPtr myCumulativeDigest;
+  // All zeros while we have no cumulative digest for that round
+  Digest myCumulativeDigest;
   bool doRecovery = true;
 
   // Check when doRecovery is not required
-  if (roundNoOfCumulativeDigest < m_lastRecoveryRound || m_stableRound == 0) {
+  if (roundNoOfCumulativeDigest <= m_droppedRound) {
+    // That round is no longer in the round log, the sender is far behind
+    // us and will recover from its own comparisons
+    _LOG_DEBUG_ID("    Received cumulative in round=" << roundNoOfCumulativeDigest <<
+                  " already removed from round log (m_droppedRound=" << m_droppedRound <<
+                  ") DO NOT RECOVERY");
+    doRecovery = false;
+  }
+  else if (roundNoOfCumulativeDigest < m_lastRecoveryRound || m_stableRound == 0) {
     // We don't have cumulative digests calculated to compare with the
     // one received
     _LOG_DEBUG_ID("    Received cumulative in round=" << roundNoOfCumulativeDigest << " my stableRound="  <<
@@ -1023,7 +1542,7 @@ Logic::checkRecovery(ndn::Name userPrefix,
       _LOG_DEBUG_ID("    Comparing cumulative digests");
       printDigest(cumulativeDigest, "received cumulative digest in Data");
       printDigest(myCumulativeDigest, "my cumulative digest");
-      if (*cumulativeDigest == *myCumulativeDigest) {
+      if (cumulativeDigest == myCumulativeDigest) {
         _LOG_DEBUG_ID("    Received cumulative in round =" << roundNoOfCumulativeDigest << ", my stableRound = "  <<
                   m_stableRound << ": same cumulative digest. DO NOT RECOVERY");
   	doRecovery = false;
@@ -1058,9 +1577,24 @@ Logic::checkRecovery(ndn::Name userPrefix,
     std::set<ndn::Name>::iterator itPrefix =
       m_pendingRecoveryPrefixes.find(userPrefix.getPrefix(-1));
     if (itPrefix == m_pendingRecoveryPrefixes.end()){
-      m_scheduler.scheduleEvent
-	(ndn::time::seconds(0),
-	 bind(&Logic::sendRecoInterest, this, userPrefix.getPrefix(-1)));
+      // If our cumulative digests differ, look for the last round in which
+      // they were the same before asking for a Reco Data, unless a previous
+      // bisection with this prefix did not fix our state
+      std::map<Name, RoundNo>::iterator bisectedIter =
+        m_bisectedPrefixes.find(userPrefix.getPrefix(-1));
+      bool hasBisected = bisectedIter != m_bisectedPrefixes.end() &&
+                         bisectedIter->second == m_lastRecoveryRound;
+      if (bisectedIter != m_bisectedPrefixes.end())
+        m_bisectedPrefixes.erase(bisectedIter);
+
+      if (hasBisected)
+        _LOG_DEBUG_ID("    Bisection with " << userPrefix.getPrefix(-1) << " did not converge");
+
+      if (myCumulativeDigest.isZero() || hasBisected ||
+          !startBisection(userPrefix.getPrefix(-1), roundNoOfCumulativeDigest))
+        m_scheduler.scheduleEvent
+          (ndn::time::seconds(0),
+           bind(&Logic::sendRecoInterest, this, userPrefix.getPrefix(-1)));
 
       _LOG_DEBUG_ID("    inserting in m_pendingRecoveryPrefixes: " << userPrefix.getPrefix(-1));
 
@@ -1075,7 +1609,7 @@ Logic::checkRecovery(ndn::Name userPrefix,
     // schedule sending a CumulativeOnly  with our cumulative
     // digest to inform others. If in the meanwhile another node has
     // sent it, cancel (in processData)
-    if (myCumulativeDigest) {
+    if (!myCumulativeDigest.isZero()) {
       _LOG_DEBUG_ID("    Program to send my cumulative digest for the round=" << roundNoOfCumulativeDigest);
       ndn::EventId eventId=
 	m_scheduler.scheduleEvent
@@ -1085,9 +1619,7 @@ Logic::checkRecovery(ndn::Name userPrefix,
 	      roundNoOfCumulativeDigest,
 	      myCumulativeDigest));
 
-      m_cumulativeDigestToEventId.insert
-  	(std::pair<ndn::Buffer,
-  	 ndn::EventId>(*myCumulativeDigest, eventId));
+      m_cumulativeDigestToEventId.insert(std::make_pair(myCumulativeDigest, eventId));
     }
 
   }
@@ -1097,33 +1629,308 @@ Logic::checkRecovery(ndn::Name userPrefix,
 
 
 
-void
-Logic::processSyncInterest(const shared_ptr<const Interest>& interest)
+bool
+Logic::startBisection(const Name& userPrefix, RoundNo differingRound)
 {
-  _LOG_DEBUG_ID(">> Logic::processSyncInterest");
-  const Name name = interest->getName();
-  //_LOG_DEBUG_ID("  InterestName: " << name);
+  _LOG_DEBUG_ID(">> Logic::startBisection");
+
+  // Cumulative digests before m_lastRecoveryRound aren't reliable
+  Bisection bisection;
+  for (DiffStateContainer::iterator stateIter = m_log.lower_bound(m_lastRecoveryRound);
+       stateIter != m_log.end() && (*stateIter)->getRound() < differingRound;
+       ++stateIter) {
+    if (!(*stateIter)->getCumulativeDigest().isZero())
+      bisection.rounds.push_back((*stateIter)->getRound());
+  }
 
-  RoundNo roundNo          = name.get(-2).toNumber();
-  _LOG_DEBUG_ID("    roundNo: " << roundNo);
+  if (bisection.rounds.empty()) {
+    _LOG_DEBUG_ID("    No round to bisect before round " << differingRound);
+    _LOG_DEBUG_ID("<< Logic::startBisection");
+    return false;
+  }
 
-  ConstBufferPtr roundDigest =
-    make_shared<ndn::Buffer>(name.get(-1).value(),
-                             name.get(-1).value_size());
+  bisection.low = -1;
+  bisection.high = bisection.rounds.size();
+  bisection.lastRecoveryRound = m_lastRecoveryRound;
 
+  _LOG_DEBUG_ID("    Bisect " << bisection.rounds.size() << " rounds from " <<
+                bisection.rounds.front() << " to " << bisection.rounds.back() <<
+                " with " << userPrefix);
+  m_bisections[userPrefix] = bisection;
 
-  // We move to the latest known round as soon as we know about its existence
-  if (roundNo >= m_currentRound) {
-    moveToNewCurrentRound(roundNo + 1);
-  }
-  else if (roundNo <= m_lastRecoveryRound) {
-    // roundNo <= m_lastRecoveryRound is too old, do nothing.
-    // We don't have reliable round digest after a recovery
-    _LOG_DEBUG_ID("    RoundNo= " << roundNo << " is less than m_lastRecoveryRound=" <<
-                  m_lastRecoveryRound << " DON'T CHECK ROUND DIGEST");
-  }
-  else {
-    checkRoundDigests(roundNo, roundDigest);
+  m_scheduler.scheduleEvent(ndn::time::seconds(0),
+                            bind(&Logic::sendCumulativeDigestInterest, this, userPrefix));
+
+  _LOG_DEBUG_ID("<< Logic::startBisection");
+  return true;
+}
+
+void
+Logic::sendCumulativeDigestInterest(const Name& userPrefix)
+{
+  _LOG_DEBUG_ID(">> Logic::sendCumulativeDigestInterest");
+
+  if (partitioned) {
+    _LOG_DEBUG_ID("    Partitioned: dropping Interest ");
+    return;
+  }
+
+  std::map<Name, Bisection>::iterator bisectionIter = m_bisections.find(userPrefix);
+  if (bisectionIter == m_bisections.end())
+    return;
+
+  const Bisection& bisection = bisectionIter->second;
+  RoundNo roundNo = bisection.rounds[(bisection.low + bisection.high) / 2];
+
+  Name interestName;
+  interestName.append(userPrefix)
+    .append(RECO_INTEREST_COMPONENT)
+    .append(CUMULATIVE_INTEREST_COMPONENT)
+    .append(ndn::name::Component::fromNumber(roundNo));
+
+  Interest interest(interestName);
+  interest.setMustBeFresh(true);
+  interest.setInterestLifetime(m_rttEstimator.getRto(userPrefix));
+
+  m_face.expressInterest(interest,
+                         bind(&Logic::onCumulativeDigestData, this, _1, _2),
+                         bind(&Logic::onCumulativeDigestInterestTimeout, this, _1));
+
+  _LOG_DEBUG_ID("    Send cumulative digest interest: " << interest.getName());
+  _LOG_DEBUG_ID("<< Logic::sendCumulativeDigestInterest");
+}
+
+void
+Logic::continueBisection(const Name& userPrefix, RoundNo roundNo, bool isSame)
+{
+  _LOG_DEBUG_ID(">> Logic::continueBisection");
+  _LOG_DEBUG_ID("    round " << roundNo << (isSame ? " same" : " different") <<
+                " cumulative digest as " << userPrefix);
+
+  std::map<Name, Bisection>::iterator bisectionIter = m_bisections.find(userPrefix);
+  if (bisectionIter == m_bisections.end())
+    return;
+
+  Bisection& bisection = bisectionIter->second;
+  ssize_t probe = (bisection.low + bisection.high) / 2;
+  if (bisection.rounds[probe] != roundNo) {
+    _LOG_DEBUG_ID("    Not the round being probed");
+    return;
+  }
+
+  if (isSame)
+    bisection.low = probe;
+  else
+    bisection.high = probe;
+
+  if (bisection.high - bisection.low > 1 &&
+      bisection.lastRecoveryRound == m_lastRecoveryRound)
+    sendCumulativeDigestInterest(userPrefix);
+  else
+    finishBisection(userPrefix);
+
+  _LOG_DEBUG_ID("<< Logic::continueBisection");
+}
+
+void
+Logic::finishBisection(const Name& userPrefix)
+{
+  _LOG_DEBUG_ID(">> Logic::finishBisection");
+
+  std::map<Name, Bisection>::iterator bisectionIter = m_bisections.find(userPrefix);
+  if (bisectionIter == m_bisections.end())
+    return;
+
+  Bisection bisection = bisectionIter->second;
+  m_bisections.erase(bisectionIter);
+
+  if (bisection.lastRecoveryRound != m_lastRecoveryRound) {
+    // A recovery happened in the meantime, it has already fixed our state
+    _LOG_DEBUG_ID("    Recovered during the bisection, give up");
+    m_pendingRecoveryPrefixes.erase(userPrefix);
+    return;
+  }
+
+  if (bisection.low < 0 || bisection.rounds[bisection.low] <= m_droppedRound) {
+    // The common round is no longer in the round log
+    _LOG_DEBUG_ID("    No common round with " << userPrefix << ", send Reco Interest");
+    sendRecoInterest(userPrefix);
+    return;
+  }
+
+  RoundNo commonRound = bisection.rounds[bisection.low];
+  _LOG_DEBUG_ID("    Last common round with " << userPrefix << ": " << commonRound);
+  m_pendingRecoveryPrefixes.erase(userPrefix);
+
+  // Restart stabilization from our state, as after a recovery, so that Data
+  // of the rounds after commonRound are accepted again. This doesn't roll
+  // our state back to commonRound: if it still differs once the rounds
+  // have been fetched again, checkRecovery sends a Reco Interest
+  finishRecovery(m_currentRound - 1);
+  m_bisectedPrefixes[userPrefix] = m_lastRecoveryRound;
+
+  // finishRecovery already fetches the last BACK_UNSTABLE_ROUNDS rounds
+  RoundNo endRound = m_currentRound <= BACK_UNSTABLE_ROUNDS ? 1 : m_currentRound - BACK_UNSTABLE_ROUNDS;
+  _LOG_DEBUG_ID("    sendDataInterest from: " << commonRound + 1 << " to: " << endRound);
+  if (commonRound + 1 < endRound)
+    sendDataInterests(commonRound + 1, endRound - 1);
+
+  _LOG_DEBUG_ID("<< Logic::finishBisection");
+}
+
+void
+Logic::onCumulativeDigestData(const Interest& interest, Data& data)
+{
+  _LOG_DEBUG_ID(">> Logic::onCumulativeDigestData");
+  _LOG_DEBUG_ID("    name " << interest.getName());
+
+  if (partitioned) {
+    _LOG_DEBUG_ID("    Partitioned: dropping Data");
+    return;
+  }
+
+  // The round is read back from the Data name
+  if (data.getName().size() != interest.getName().size()) {
+    _LOG_DEBUG_ID("    Unexpected Data name " << data.getName());
+    continueBisection(interest.getName().getPrefix(-3), interest.getName().get(-1).toNumber(), false);
+    return;
+  }
+
+  m_merkleValidator.validate(data, m_validator,
+                             bind(&Logic::onCumulativeDigestDataValidated, this, _1),
+                             bind(&Logic::onCumulativeDigestDataValidationFailed, this, _1));
+
+  _LOG_DEBUG_ID("<< Logic::onCumulativeDigestData");
+}
+
+void
+Logic::onCumulativeDigestDataValidated(const shared_ptr<const Data>& data)
+{
+  const Name& name = data->getName();
+  if (!name.get(-1).isNumber())
+    return;
+
+  Name userPrefix = name.getPrefix(-3);
+  RoundNo roundNo = name.get(-1).toNumber();
+
+  bool isSame = false;
+  try {
+    DataContent dataContent;
+    dataContent.wireDecode(data->getContent().blockFromValue());
+
+    // A CumulativeOnly of round 0 means the peer has no stable cumulative
+    // digest for the round: it can't be counted as the same
+    if (dataContent.getRoundNo() == 0)
+      _LOG_DEBUG_ID("    No cumulative digest for round " << roundNo << " at " << userPrefix);
+
+    DiffStateContainer::iterator stateIter = m_log.find(roundNo);
+    isSame = dataContent.hasCumulativeDigest() &&
+             dataContent.getRoundNo() == roundNo &&
+             stateIter != m_log.end() &&
+             (*stateIter)->getCumulativeDigest() == dataContent.getCumulativeDigest();
+  }
+  catch (DataContent::Error&) {
+    _LOG_DEBUG_ID("    Malformed DataContent");
+  }
+  catch (ndn::tlv::Error&) {
+    _LOG_DEBUG_ID("    Malformed DataContent");
+  }
+
+  continueBisection(userPrefix, roundNo, isSame);
+}
+
+void
+Logic::onCumulativeDigestDataValidationFailed(const shared_ptr<const Data>& data)
+{
+  _LOG_DEBUG_ID(">> Logic::onCumulativeDigestDataValidationFailed");
+  const Name& name = data->getName();
+  if (!name.get(-1).isNumber())
+    return;
+
+  continueBisection(name.getPrefix(-3), name.get(-1).toNumber(), false);
+}
+
+void
+Logic::onCumulativeDigestInterestTimeout(const Interest& interest)
+{
+  _LOG_DEBUG_ID(">> Logic::onCumulativeDigestInterestTimeout");
+  _LOG_DEBUG_ID("    Interest: " << interest.getName());
+
+  const Name& name = interest.getName();
+  if (!name.get(-1).isNumber())
+    return;
+
+  continueBisection(name.getPrefix(-3), name.get(-1).toNumber(), false);
+}
+
+void
+Logic::processCumulativeDigestInterest(const shared_ptr<const Interest>& interest)
+{
+  _LOG_DEBUG_ID(">> Logic::processCumulativeDigestInterest");
+  const Name& name = interest->getName();
+  _LOG_DEBUG_ID("    InterestName: " << name);
+
+  if (!name.get(-1).isNumber()) {
+    _LOG_DEBUG_ID("    Malformed round, ignoring Interest");
+    return;
+  }
+
+  RoundNo roundNo = name.get(-1).toNumber();
+
+  // Only stable cumulative digests computed since our last recovery
+  // can be compared. Otherwise answer a CumulativeOnly of round 0, so the
+  // requester doesn't wait for the Interest to time out
+  DiffStateContainer::iterator stateIter = m_log.find(roundNo);
+  bool isStable = !(m_stableRound == 0 || roundNo > m_stableRound || roundNo < m_lastRecoveryRound ||
+                    stateIter == m_log.end() || (*stateIter)->getCumulativeDigest().isZero());
+  if (!isStable)
+    _LOG_DEBUG_ID("    No cumulative digest for round " << roundNo);
+
+  DataContent dataContent(m_sessionName,
+                          isStable ? roundNo : 0,
+                          isStable ? (*stateIter)->getCumulativeDigest() : Digest());
+
+  shared_ptr<Data> data = make_shared<Data>(name);
+  data->setContent(dataContent.wireEncode());
+  data->setFreshnessPeriod(m_dataFreshness);
+
+  m_signingPipeline.sign(data, m_defaultSigningId,
+                         bind(&Logic::onDataSigned, this, _1, DiffStatePtr(), DiffStatePtr()));
+
+  _LOG_DEBUG_ID("<< Logic::processCumulativeDigestInterest");
+}
+
+
+void
+Logic::processSyncInterest(const shared_ptr<const Interest>& interest)
+{
+  _LOG_DEBUG_ID(">> Logic::processSyncInterest");
+  const Name name = interest->getName();
+  //_LOG_DEBUG_ID("  InterestName: " << name);
+
+  // The name carries the last round and the round digests of the rounds
+  // up to it, oldest first
+  RoundNo roundNo          = name.get(-2).toNumber();
+  _LOG_DEBUG_ID("    roundNo: " << roundNo);
+
+  const ndn::name::Component& digests = name.get(-1);
+  size_t nRounds = digests.value_size() / Digest::SIZE;
+  if (nRounds == 0 || digests.value_size() % Digest::SIZE != 0 || nRounds > roundNo) {
+    _LOG_DEBUG_ID("    Malformed round digests, ignoring Sync Interest");
+    return;
+  }
+
+  std::vector<Digest> roundDigests;
+  roundDigests.reserve(nRounds);
+  for (size_t i = 0; i < nRounds; ++i)
+    roundDigests.push_back(Digest(digests.value() + i * Digest::SIZE, Digest::SIZE));
+
+  // Check the rounds before our current round in one pass
+  checkRoundDigests(roundNo - nRounds + 1, roundDigests);
+
+  // We move to the latest known round as soon as we know about its existence
+  if (roundNo >= m_currentRound) {
+    moveToNewCurrentRound(roundNo + 1);
   }
 
   _LOG_DEBUG_ID("<< Logic::processSyncInterest");
@@ -1160,6 +1967,72 @@ Logic::processData(const Name& fullName,
   if (roundNo == m_currentRound)
     syncTimeouts = 0;
 
+  processRoundData(roundNo, fullName.get(-1), dataContentBlock);
+
+  _LOG_DEBUG_ID("<< Logic::processData");
+}
+
+void
+Logic::processDataRange(const Name& fullName,
+                        const Block& multiRoundBlock)
+{
+  _LOG_DEBUG_ID(">> Logic::processDataRange");
+
+  RoundNo from = fullName.get(-3).toNumber();
+  RoundNo to = fullName.get(-2).toNumber();
+
+  // Ask for the contributions of the other producers to the range
+  std::map<std::pair<RoundNo, RoundNo>, ndn::Exclude>::iterator excludeIter =
+    m_dataRangeExcludes.find(std::make_pair(from, to));
+  if (excludeIter != m_dataRangeExcludes.end()) {
+    excludeIter->second.excludeOne(fullName.get(-1));
+    m_scheduler.scheduleEvent(ndn::time::seconds(0),
+                              bind(&Logic::sendDataRangeInterest, this, from, to, 1));
+  }
+
+  MultiRoundContent multiRoundContent;
+  try {
+    multiRoundContent.wireDecode(multiRoundBlock);
+  }
+  catch (MultiRoundContent::Error&) {
+    _LOG_DEBUG_ID("    Malformed MultiRoundContent");
+    return;
+  }
+  catch (DataContent::Error&) {
+    _LOG_DEBUG_ID("    Malformed DataContent");
+    return;
+  }
+
+  BOOST_FOREACH (const MultiRoundContent::RoundList::value_type& round,
+                 multiRoundContent.getRounds())
+    {
+      if (round.first < from || round.first > to) {
+        _LOG_DEBUG_ID("    Round " << round.first << " out of range");
+        continue;
+      }
+
+      _LOG_DEBUG_ID("    Data of round " << round.first);
+      // There is no Data of this round to exclude
+      processRoundData(round.first, ndn::name::Component(), round.second->wireEncode());
+    }
+
+  // The producer left out the rounds from nextRound on, ask for them
+  RoundNo nextRound = multiRoundContent.getNextRound();
+  if (nextRound > from && nextRound <= to &&
+      m_dataRangeExcludes.find(std::make_pair(nextRound, to)) == m_dataRangeExcludes.end()) {
+    _LOG_DEBUG_ID("    Ask again for rounds " << nextRound << " to " << to);
+    sendDataInterests(nextRound, to);
+  }
+
+  _LOG_DEBUG_ID("<< Logic::processDataRange");
+}
+
+void
+Logic::processRoundData(RoundNo roundNo,
+                        const ndn::name::Component& implicitDigest,
+                        const Block& dataContentBlock)
+{
+  _LOG_DEBUG_ID(">> Logic::processRoundData");
   _LOG_DEBUG_ID("    roundNo:" << roundNo);
 
   if (roundNo <= m_stableRound) {
@@ -1168,7 +2041,7 @@ Logic::processData(const Name& fullName,
     // recovery.
     _LOG_DEBUG_ID("    Very old round=" << roundNo << " minor than m_stableRound=" << m_stableRound <<
                   " Do nothing.");
-    _LOG_DEBUG_ID("<< Logic::processData");
+    _LOG_DEBUG_ID("<< Logic::processRoundData");
     return;
   }
 
@@ -1182,10 +2055,14 @@ Logic::processData(const Name& fullName,
   else{
     commit = make_shared<DiffState>();
   }
+  // What this Data adds to the round, for the persistent log
+  DiffStatePtr added = make_shared<DiffState>();
 
   // Update exclude filter in commit
-  _LOG_DEBUG_ID("    Update exclude filter with: " << fullName.get(-1));
-  commit->appendExclude(fullName.get(-1));
+  if (!implicitDigest.empty()) {
+    _LOG_DEBUG_ID("    Update exclude filter with: " << implicitDigest);
+    commit->appendExclude(implicitDigest);
+  }
 
   try {
     DataContent dataContent;
@@ -1197,8 +2074,11 @@ Logic::processData(const Name& fullName,
 
     if (dataType == tlv::CumulativeOnly) {
       // Add to commit [dataContent.getUserPrefix(), CUMULATIVE_ONLY_DATA]
-      commit->update(dataContent.getUserPrefix(), CUMULATIVE_ONLY_DATA);
-      _LOG_DEBUG_ID("    Data from " << dataContent.getUserPrefix());
+      Name userPrefix = dataContent.getUserPrefix();
+      SessionKey session(userPrefix);
+      commit->update(session, CUMULATIVE_ONLY_DATA);
+      added->update(session, CUMULATIVE_ONLY_DATA);
+      _LOG_DEBUG_ID("    Data from " << userPrefix);
     }
 
     // Process cumulative digest
@@ -1206,7 +2086,7 @@ Logic::processData(const Name& fullName,
         dataType == tlv::DataAndCumulative) {
       ndn::Name           userPrefix = dataContent.getUserPrefix();
       RoundNo             roundNoOfCumulativeDigest = dataContent.getRoundNo();
-      ndn::ConstBufferPtr cumulativeDigest = dataContent.getCumulativeDigest();
+      const Digest&       cumulativeDigest = dataContent.getCumulativeDigest();
 
       checkRecovery(userPrefix, roundNoOfCumulativeDigest, cumulativeDigest);
     }
@@ -1219,10 +2099,8 @@ Logic::processData(const Name& fullName,
       StatePtr reply = dataContent.getState();
 
       std::vector<MissingDataInfo> v;
-      BOOST_FOREACH(ConstLeafPtr leaf, reply->getLeaves().get<ordered>())
+      BOOST_FOREACH(ConstLeafRef leaf, reply->getLeaves().get<ordered>())
         {
-          BOOST_ASSERT(leaf != 0);
-
           const Name& info = leaf->getSessionName();
           SeqNo seq = leaf->getSeq();
 
@@ -1236,9 +2114,9 @@ Logic::processData(const Name& fullName,
 	  // If we are in the state of having received a recovery and
 	  // not yet stabilized, apply received data to m_oldState
 	  if (roundNo <= m_lastRecoveryRound && m_stableRound == 0)
-	    m_oldState.update(info, seq);
+	    m_oldState.update(leaf->getSessionKey(), seq);
 
-          boost::tie(isInserted, isUpdated, oldSeq) = m_state.update(info, seq);
+          boost::tie(isInserted, isUpdated, oldSeq) = m_state.update(leaf->getSessionKey(), seq);
           if (isInserted || isUpdated) {
             oldSeq++;
             MissingDataInfo mdi = {info, oldSeq, seq};
@@ -1246,7 +2124,8 @@ Logic::processData(const Name& fullName,
           }
           // Either if we already knew this info or not, update the
           // round log entry
-          commit->update(info, seq);
+          commit->update(leaf->getSessionKey(), seq);
+          added->update(leaf->getSessionKey(), seq);
 
         }
 
@@ -1265,7 +2144,7 @@ Logic::processData(const Name& fullName,
       moveToNewCurrentRound(m_currentRound + 1);
 
     _LOG_DEBUG_ID("    update round log for round " << roundNo << " with received data");
-    updateDiffLog(commit, roundNo);
+    updateDiffLog(commit, roundNo, added);
 
 
     // New data received for roundNo <= m_stabilizingRound, so delay
@@ -1284,11 +2163,7 @@ Logic::processData(const Name& fullName,
     // Send round digest in the future, so it covers everything we
     // have fished (either DataOnly, CumulativeOnly or
     // DataAndCumulative) in this round
-    EventId eventId =
-      m_scheduler.scheduleEvent(DEFAULT_ROUND_DIGEST_DELAY,
-                                bind(&Logic::sendSyncInterest, this, roundNo));
-    m_scheduler.cancelEvent(commit->getReexpressingSyncInterestId());
-    commit->setReexpressingSyncInterestId(eventId);
+    scheduleSyncInterest(roundNo);
 
 
 #ifdef _DEBUG
@@ -1302,16 +2177,35 @@ Logic::processData(const Name& fullName,
     commit.reset();
     return;
   }
+  catch (DataContent::Error&) {
+    _LOG_DEBUG_ID("    Malformed DataContent");
+    commit.reset();
+    return;
+  }
 }
 
 void
 Logic::processRecoData(const Name& fullName,
-                       const Block& recoBlock)
+                       const Block& recoBlock,
+                       uint64_t finalSegment)
 {
   _LOG_DEBUG_ID(">> Logic::processRecoData");
 
-  m_pendingRecoveryPrefixes.erase(fullName.getPrefix(-2));
-  _LOG_DEBUG_ID("    Removing from m_pendingRecoveryPrefixes: " << fullName.getPrefix(-2));
+  Name userPrefix = getRecoUserPrefix(fullName.getPrefix(-2));
+  uint64_t segment = fullName.get(-2).toSegment();
+
+  std::map<Name, RecoFetch>::iterator fetchIter = m_recoFetches.find(userPrefix);
+  if (fetchIter == m_recoFetches.end() ||
+      fetchIter->second.pendingSegments.erase(segment) == 0) {
+    _LOG_DEBUG_ID("    Reco Data segment " << segment << " not wanted");
+    return;
+  }
+
+  RecoFetch& fetch = fetchIter->second;
+  fetch.timeouts = 0;
+  fetch.hasFinalSegment = true;
+  fetch.finalSegment = finalSegment;
+  _LOG_DEBUG_ID("    segment " << segment << " of " << finalSegment);
 
   try {
     RecoData recoData;
@@ -1323,14 +2217,26 @@ Logic::processRecoData(const Name& fullName,
       throw new Error("");
 
     RoundNo roundNoOfState = recoData.getRoundNo();
+    fetch.roundNo = std::max(fetch.roundNo, roundNoOfState);
+
+    // Ask for the next segments by the transfer id of the first one
+    if (segment == 0 && recoData.getTransferId() != 0) {
+      fetch.name = Name(userPrefix).append(RECO_INTEREST_COMPONENT)
+        .append(ndn::name::Component::fromVersion(recoData.getTransferId()));
+      _LOG_DEBUG_ID("    transfer " << recoData.getTransferId());
+    }
+
+    // A delta only has the leaves changed after our stable round, merging
+    // it into m_state works the same as merging a full state
+    _LOG_DEBUG_ID("    Reco Data of round " << roundNoOfState <<
+                  (recoData.getBaseRoundNo() != 0 ? " changes after round " : " full state") <<
+                  (recoData.getBaseRoundNo() != 0 ? std::to_string(recoData.getBaseRoundNo()) : ""));
 
     StatePtr receivedState = recoData.getState();
 
     std::vector<MissingDataInfo> v;
-    BOOST_FOREACH(ConstLeafPtr leaf, receivedState->getLeaves().get<ordered>())
+    BOOST_FOREACH(ConstLeafRef leaf, receivedState->getLeaves().get<ordered>())
       {
-        BOOST_ASSERT(leaf != 0);
-
         const Name& info = leaf->getSessionName();
         SeqNo seq = leaf->getSeq();
 
@@ -1338,7 +2244,7 @@ Logic::processRecoData(const Name& fullName,
         bool isUpdated = false;
         SeqNo oldSeq;
 
-        boost::tie(isInserted, isUpdated, oldSeq) = m_state.update(info, seq);
+        boost::tie(isInserted, isUpdated, oldSeq) = m_state.update(leaf->getSessionKey(), seq);
         if (isInserted || isUpdated) {
           oldSeq++;
           MissingDataInfo mdi = {info, oldSeq, seq};
@@ -1349,73 +2255,100 @@ Logic::processRecoData(const Name& fullName,
       if (!v.empty()) {
         // call app's callback
         _LOG_DEBUG_ID("    call app's callback with new data");
+#ifdef _DEBUG
         printState(std::cerr, m_state);
+#endif
         m_onUpdate(v);
       }
       else
         _LOG_DEBUG_ID("    don't call app's callback: nothing new");
+  }
 
-      // We have received a recovery data, we have to wait some
-      // time to stabilize a new cd
-      if (roundNoOfState >= m_currentRound) {
-        // RecoveryRound is the roundNo received,
-        // because it is the last round we know there have been produced data
-        m_lastRecoveryRound = roundNoOfState;
-        // ... and move current to next one, to request new data
-        // data has already been produced in roundNoState
-        moveToNewCurrentRoundAfterRecovery(roundNoOfState + 1);
-      }
-      else {
-        // RecoveryRound is the mcurrentRound -1,
-        // because it is the last round we know there have been produced data
-        m_lastRecoveryRound = m_currentRound - 1;
-      }
+  catch (State::Error&) {
+    _LOG_DEBUG_ID("    Something really fishy happened during state decoding");
+    // Something really fishy happened during state decoding;
+    // give up this recovery
+    m_pendingRecoveryPrefixes.erase(userPrefix);
+    m_recoFetches.erase(fetchIter);
+    return;
+  }
 
-      _LOG_DEBUG_ID("    Update lastRecoveryRound = " << m_lastRecoveryRound);
+  if (!fetch.pendingSegments.empty() || fetch.nextSegment <= fetch.finalSegment) {
+    // Keep the window full
+    sendRecoSegmentInterests(userPrefix);
+    return;
+  }
 
-      // Proceed to fish in m_currentRound and some previous rounds
-      RoundNo initRound;
-      if (m_currentRound <= BACK_UNSTABLE_ROUNDS) {
-          initRound = 1;
-      } else {
-          initRound = m_currentRound-BACK_UNSTABLE_ROUNDS;
-      }
+  // All the segments have been received
+  RoundNo roundNoOfState = fetch.roundNo;
+  m_recoFetches.erase(fetchIter);
+  m_pendingRecoveryPrefixes.erase(userPrefix);
+  _LOG_DEBUG_ID("    Removing from m_pendingRecoveryPrefixes: " << userPrefix);
 
-      _LOG_DEBUG_ID("    BACK unstable rouds -> sendDataInterest from: " << initRound
-                    << " to: " << m_currentRound);
-      for (auto i = initRound; i< m_currentRound; i++){
-          EventId eventId =
-            m_scheduler.scheduleEvent(ndn::time::seconds(0),
-                                      bind(&Logic::sendDataInterest, this, i, 1));
-      }
+  finishRecovery(roundNoOfState);
+}
 
+void
+Logic::finishRecovery(RoundNo roundNoOfState)
+{
+  _LOG_DEBUG_ID(">> Logic::finishRecovery");
+
+  // We have received a recovery data, we have to wait some
+  // time to stabilize a new cd
+  if (roundNoOfState >= m_currentRound) {
+    // RecoveryRound is the roundNo received,
+    // because it is the last round we know there have been produced data
+    m_lastRecoveryRound = roundNoOfState;
+    // ... and move current to next one, to request new data
+    // data has already been produced in roundNoState
+    moveToNewCurrentRoundAfterRecovery(roundNoOfState + 1);
+  }
+  else {
+    // RecoveryRound is the mcurrentRound -1,
+    // because it is the last round we know there have been produced data
+    m_lastRecoveryRound = m_currentRound - 1;
+  }
 
-      // the recovery data invalidates current stabilizing
-      // round. After recovery, we begin to stabilize the round to
-      // which we have applied the reco data
-      m_stabilizingRound = m_lastRecoveryRound;
+  _LOG_DEBUG_ID("    Update lastRecoveryRound = " << m_lastRecoveryRound);
 
-      // we don't have a stable round after a recovery
-      m_stableRound = 0;
-      // But we want to remember the state in the moment of recovery
-      m_oldState.reset();
-      m_oldState += m_state;
+  // Proceed to fish in m_currentRound and some previous rounds
+  RoundNo initRound;
+  if (m_currentRound <= BACK_UNSTABLE_ROUNDS) {
+      initRound = 1;
+  } else {
+      initRound = m_currentRound-BACK_UNSTABLE_ROUNDS;
+  }
 
+  _LOG_DEBUG_ID("    BACK unstable rouds -> sendDataInterest from: " << initRound
+                << " to: " << m_currentRound);
+  if (initRound < m_currentRound)
+    sendDataInterests(initRound, m_currentRound - 1);
 
-      // Reschedule calculation of stable state
-      m_scheduler.cancelEvent(m_stabilizingCumulativeDigest);
-      m_stabilizingCumulativeDigest =
-      m_scheduler.scheduleEvent(DEFAULT_STABILIZE_CUMULATIVE_DIGEST_DELAY,
-				    bind(&Logic::setStableState, this));
 
-  }
+  // the recovery data invalidates current stabilizing
+  // round. After recovery, we begin to stabilize the round to
+  // which we have applied the reco data
+  m_stabilizingRound = m_lastRecoveryRound;
 
-  catch (State::Error&) {
-    _LOG_DEBUG_ID("    Something really fishy happened during state decoding");
-    // Something really fishy happened during state decoding;
-    return;
-  }
+  // we don't have a stable round after a recovery
+  m_stableRound = 0;
+  // But we want to remember the state in the moment of recovery
+  m_oldState.reset();
+  m_oldState += m_state;
+
+
+  // Reschedule calculation of stable state
+  m_scheduler.cancelEvent(m_stabilizingCumulativeDigest);
+  m_stabilizingCumulativeDigest =
+  m_scheduler.scheduleEvent(DEFAULT_STABILIZE_CUMULATIVE_DIGEST_DELAY,
+				    bind(&Logic::setStableState, this));
 
+  // The recovered state replaces the stable state, don't wait for the
+  // log to grow to persist it
+  if (m_store)
+    writeSnapshot();
+
+  _LOG_DEBUG_ID("<< Logic::finishRecovery");
 }
 
 
@@ -1441,7 +2374,7 @@ Logic::printRoundLog()
     std::cerr << "    round: " << (*stateIter)->getRound() << std::endl;
     printDigest((*stateIter)->getCumulativeDigest(), "cd");
     printDigest((*stateIter)->getRoundDigest(), "rd");
-    printState(std::cerr, *(*stateIter)->getState());
+    printState(std::cerr, **stateIter);
     ++stateIter;
   }
 
@@ -1454,7 +2387,7 @@ Logic::printRoundLog()
 
 
 void
-Logic::updateDiffLog(DiffStatePtr commit, const RoundNo round)
+Logic::updateDiffLog(DiffStatePtr commit, const RoundNo round, DiffStatePtr added)
 {
 
   RoundNo roundNo = round;
@@ -1467,17 +2400,39 @@ Logic::updateDiffLog(DiffStatePtr commit, const RoundNo round)
   printState(std::cerr, *commit);
 #endif
 
+  if (!added)
+    added = commit;
+
   // Set round, round digest
   commit->setRound(roundNo);
-  commit->updateRoundDigest();
+  added->setRound(roundNo);
 
   DiffStateContainer::iterator stateIter = m_log.find(roundNo);
   if (stateIter == m_log.end())
     m_log.insert(commit);
+  else if (*stateIter != commit) {
+    // The entry of the round is the one kept, merge the new leaves into it
+    commit = *stateIter;
+    *commit += *added;
+    if (added->getCumulativeInfo())
+      commit->setCumulativeInfo(added->getCumulativeInfo());
+  }
+  commit->updateRoundDigest();
 
   _LOG_DEBUG_ID("     Round: " << commit->getRound());
   _LOG_DEBUG_ID("     Round Digest     : " << digestToStr(commit->getRoundDigest()));
 
+  if (m_store) {
+    try {
+      // Only the delta, the log is replayed merging the entries of a round
+      m_store->append(*added);
+    }
+    catch (StateStore::Error& e) {
+      std::cerr << "    Logic::updateDiffLog:: ERROR: " << e.what() << ", persistence disabled" << std::endl;
+      m_store.reset();
+    }
+  }
+
   _LOG_DEBUG_ID("<< Logic::updateDiffLog");
 }
 
@@ -1502,7 +2457,18 @@ Logic::sendDataInterest(RoundNo roundNo, unsigned retries)
   Interest interest(interestName);
   //  interest.setMustBeFresh(true);
   interest.setMustBeFresh(false);
-  interest.setInterestLifetime(m_dataInterestLifetime);
+
+  // Data of past rounds already exists, so its Interests are measured and
+  // expire after the RTO.  The Interest of the current round waits for
+  // new data to be produced
+  time::steady_clock::time_point sentTime;
+  if (roundNo < m_currentRound) {
+    interest.setInterestLifetime(m_rttEstimator.getRto(m_syncPrefix, retries));
+    if (retries == 1)
+      sentTime = time::steady_clock::now();
+  }
+  else
+    interest.setInterestLifetime(m_dataInterestLifetime);
 
 
   // Add exclude filter if stored in round log
@@ -1513,8 +2479,9 @@ Logic::sendDataInterest(RoundNo roundNo, unsigned retries)
 
   const ndn::PendingInterestId* pid =
     m_face.expressInterest (interest,
-                            bind(&Logic::onData, this, _1, _2),
-                            bind(&Logic::onDataInterestTimeout, this, _1, retries));
+                            bind(&Logic::onData, this, _1, _2, sentTime),
+                            bind(&Logic::onDataInterestTimeout, this, _1, retries,
+                                 roundNo < m_currentRound));
 
   // register info about outstanding interest of current round, so it
   // can be removed from face in case our application produces data
@@ -1526,10 +2493,12 @@ Logic::sendDataInterest(RoundNo roundNo, unsigned retries)
 
 
   if (roundNo == m_currentRound) {
-    // Program periodic sending of Data Interest
+    // Program periodic sending of Data Interest. The jitter is
+    // m_reexpressionJitter per mille of the RTO
+    time::milliseconds jitter(m_reexpressionJitter() *
+                              m_rttEstimator.getRto(m_syncPrefix).count() / 1000);
     EventId eventId =
-      m_scheduler.scheduleEvent(m_dataInterestLifetime +
-                                ndn::time::milliseconds(m_reexpressionJitter()),
+      m_scheduler.scheduleEvent(m_dataInterestLifetime + jitter,
                                 bind(&Logic::sendDataInterest, this, roundNo, 1));
     m_scheduler.cancelEvent(m_reexpressingDataInterestId);
     m_reexpressingDataInterestId = eventId;
@@ -1541,52 +2510,201 @@ Logic::sendDataInterest(RoundNo roundNo, unsigned retries)
 
 
 void
-Logic::sendSyncInterest(RoundNo roundNo)
+Logic::sendDataInterests(RoundNo from, RoundNo to)
 {
-  _LOG_DEBUG_ID(">> Logic::sendSyncInterest for round " << roundNo);
+  _LOG_DEBUG_ID(">> Logic::sendDataInterests from " << from << " to " << to);
+
+  for (RoundNo first = from; first <= to; first += MAX_DATA_INTEREST_RANGE) {
+    RoundNo last = std::min(to, first + MAX_DATA_INTEREST_RANGE - 1);
+
+    if (first == last) {
+      m_scheduler.scheduleEvent(ndn::time::seconds(0),
+                                bind(&Logic::sendDataInterest, this, first, 1));
+    }
+    else {
+      m_dataRangeExcludes[std::make_pair(first, last)].clear();
+      m_scheduler.scheduleEvent(ndn::time::seconds(0),
+                                bind(&Logic::sendDataRangeInterest, this, first, last, 1));
+    }
+  }
+
+  _LOG_DEBUG_ID("<< Logic::sendDataInterests");
+}
+
+void
+Logic::sendDataRangeInterest(RoundNo from, RoundNo to, unsigned retries)
+{
+  _LOG_DEBUG_ID(">> Logic::sendDataRangeInterest from " << from << " to " << to);
 
   if (partitioned) {
-    _LOG_DEBUG_ID("    Partitioned: dropping Interest ");
+    _LOG_DEBUG_ID("   Partitioned: dropping Interest ");
     return;
   }
 
+  std::map<std::pair<RoundNo, RoundNo>, ndn::Exclude>::iterator excludeIter =
+    m_dataRangeExcludes.find(std::make_pair(from, to));
+  if (excludeIter == m_dataRangeExcludes.end())
+    return;
 
   Name interestName;
   interestName.append(m_syncPrefix)
-    .append(SYNC_INTEREST_COMPONENT)
-    .append(ndn::name::Component::fromNumber(roundNo));
+    .append(DATA_INTEREST_COMPONENT)
+    .append(ndn::name::Component::fromNumber(from))
+    .append(ndn::name::Component::fromNumber(to));
 
-  // Append round digest
-  DiffStateContainer::iterator stateIter = m_log.find(roundNo);
+  Interest interest(interestName);
+  interest.setMustBeFresh(false);
+  interest.setInterestLifetime(m_rttEstimator.getRto(m_syncPrefix, retries));
+
+  // Exclude the replies of the producers already received. The RTO measures
+  // the fastest of them: wait as for a Data Interest for slower producers,
+  // as a timeout ends the range
+  if (!excludeIter->second.empty()) {
+    interest.setExclude(excludeIter->second);
+    interest.setInterestLifetime(std::max(m_dataInterestLifetime,
+                                          m_rttEstimator.getRto(m_syncPrefix, retries)));
+  }
 
-  if (stateIter != m_log.end())
-    interestName.append(ndn::name::Component((*stateIter)->getRoundDigest()));
+  time::steady_clock::time_point sentTime;
+  if (retries == 1)
+    sentTime = time::steady_clock::now();
+
+  m_face.expressInterest(interest,
+                         bind(&Logic::onData, this, _1, _2, sentTime),
+                         bind(&Logic::onDataRangeInterestTimeout, this, _1, retries));
+
+  _LOG_DEBUG_ID("<< Logic::sendDataRangeInterest");
+}
+
+void
+Logic::onDataRangeInterestTimeout(const Interest& interest, unsigned retries)
+{
+  _LOG_DEBUG_ID(">> Logic::onDataRangeInterestTimeout");
+
+  RoundNo from = interest.getName().get(-2).toNumber();
+  RoundNo to = interest.getName().get(-1).toNumber();
+
+  std::map<std::pair<RoundNo, RoundNo>, ndn::Exclude>::iterator excludeIter =
+    m_dataRangeExcludes.find(std::make_pair(from, to));
+  if (excludeIter == m_dataRangeExcludes.end())
+    return;
+
+  // Retry until a first reply. After it, a timeout means that there are no
+  // more producers in the range
+  if (excludeIter->second.empty() && retries < MAX_DATA_INTEREST_TIMEOUTS) {
+    m_scheduler.scheduleEvent(ndn::time::seconds(0),
+                              bind(&Logic::sendDataRangeInterest, this, from, to, ++retries));
+  }
   else {
-    _LOG_DEBUG_ID("    we don't have an entry for that round, so add EMPTY round digest");
-    interestName.append(ndn::name::Component(EMPTY_DIGEST));
+    _LOG_DEBUG_ID("    Done with rounds " << from << " to " << to);
+    m_dataRangeExcludes.erase(excludeIter);
   }
 
-  _LOG_DEBUG_ID("    name: " << interestName);
+  _LOG_DEBUG_ID("<< Logic::onDataRangeInterestTimeout");
+}
+
+void
+Logic::scheduleSyncInterest(RoundNo roundNo, bool isImmediate)
+{
+  bool isScheduled = !m_syncRounds.empty();
+  bool isPending = !m_syncRounds.insert(roundNo).second;
+
+  if (isImmediate) {
+    m_isSyncImmediate = true;
+    m_scheduler.cancelEvent(m_reexpressingSyncInterestId);
+    m_reexpressingSyncInterestId =
+      m_scheduler.scheduleEvent(ndn::time::seconds(0),
+                                bind(&Logic::sendSyncInterests, this));
+  }
+  else if (!isScheduled) {
+    m_syncDeadline = time::steady_clock::now() + MAX_ROUND_DIGEST_DELAY;
+    m_reexpressingSyncInterestId =
+      m_scheduler.scheduleEvent(DEFAULT_ROUND_DIGEST_DELAY,
+                                bind(&Logic::sendSyncInterests, this));
+  }
+  else if (isPending && !m_isSyncImmediate) {
+    // New data in a pending round: wait again, so that the round digest
+    // announced covers everything fished in the round, but don't hold
+    // back the pending rounds past m_syncDeadline
+    time::steady_clock::time_point now = time::steady_clock::now();
+    time::milliseconds delay = DEFAULT_ROUND_DIGEST_DELAY;
+    if (m_syncDeadline <= now)
+      delay = time::milliseconds::zero();
+    else if (m_syncDeadline - now < delay)
+      delay = time::duration_cast<time::milliseconds>(m_syncDeadline - now);
+
+    m_scheduler.cancelEvent(m_reexpressingSyncInterestId);
+    m_reexpressingSyncInterestId =
+      m_scheduler.scheduleEvent(delay, bind(&Logic::sendSyncInterests, this));
+  }
+}
+
+void
+Logic::sendSyncInterests()
+{
+  _LOG_DEBUG_ID(">> Logic::sendSyncInterests");
 
-  // Only digest interest for (current_round - 1) is resent periodically
-  //if (roundNo == m_currentRound - 1) {
-  //  m_outstandingSyncInterestName = interestName;
+  m_isSyncImmediate = false;
+
+  // Each Sync Interest covers the DEFAULT_SYNC_INTEREST_ROUNDS rounds up to
+  // the latest pending one, skipping the leading stable rounds that don't
+  // need to be announced
+  while (!m_syncRounds.empty()) {
+    RoundNo lastRound = *m_syncRounds.rbegin();
+    RoundNo firstRound = lastRound >= DEFAULT_SYNC_INTEREST_ROUNDS ?
+      lastRound - DEFAULT_SYNC_INTEREST_ROUNDS + 1 : 1;
+
+    std::set<RoundNo>::iterator first = m_syncRounds.lower_bound(firstRound);
+    firstRound = std::max(firstRound, std::min(m_stableRound + 1, *first));
+
+    sendSyncInterest(firstRound, lastRound);
+
+    m_syncRounds.erase(first, m_syncRounds.end());
+  }
+
+  _LOG_DEBUG_ID("<< Logic::sendSyncInterests");
+}
+
+void
+Logic::sendSyncInterest(RoundNo firstRound, RoundNo lastRound)
+{
+  _LOG_DEBUG_ID(">> Logic::sendSyncInterest for rounds " << firstRound << " to " << lastRound);
+
+  if (partitioned) {
+    _LOG_DEBUG_ID("    Partitioned: dropping Interest ");
+    return;
+  }
+
+  // Round digests of firstRound .. lastRound, oldest first
+  std::vector<uint8_t> digests;
+  digests.reserve((lastRound - firstRound + 1) * Digest::SIZE);
+  for (RoundNo roundNo = firstRound; roundNo <= lastRound; ++roundNo) {
+    DiffStateContainer::iterator stateIter = m_log.find(roundNo);
+
+    if (stateIter != m_log.end()) {
+      const Digest& roundDigest = (*stateIter)->getRoundDigest();
+      digests.insert(digests.end(), roundDigest.data(), roundDigest.data() + Digest::SIZE);
+    }
+    else {
+      _LOG_DEBUG_ID("    we don't have an entry for round " << roundNo << ", so add EMPTY round digest");
+      digests.insert(digests.end(), EMPTY_DIGEST.data(), EMPTY_DIGEST.data() + Digest::SIZE);
+    }
+  }
+
+  Name interestName;
+  interestName.append(m_syncPrefix)
+    .append(SYNC_INTEREST_COMPONENT)
+    .append(ndn::name::Component::fromNumber(lastRound))
+    .append(ndn::name::Component(digests.data(), digests.size()));
 
-  //  EventId eventId =
-  //    m_scheduler.scheduleEvent(m_syncInterestLifetime +
-  //                              ndn::time::milliseconds(m_reexpressionJitter()),
-  //                              bind(&Logic::sendSyncInterest, this, roundNo));
-  //  m_scheduler.cancelEvent(m_reexpressingSyncInterestId);
-  //  m_reexpressingSyncInterestId = eventId;
- // }
+  _LOG_DEBUG_ID("    name: " << interestName);
 
   Interest interest(interestName);
   interest.setMustBeFresh(true);
-  interest.setInterestLifetime(m_syncInterestLifetime);
-
-  //m_outstandingSyncInterestId = m_face.expressInterest(interest,
-  //                                                       bind(&Logic::onSyncData, this, _1, _2),
-  //                                                       bind(&Logic::onSyncInterestTimeout, this, _1));
+  // Sync Interests are not answered, they only need to live until they
+  // reach the other nodes
+  interest.setInterestLifetime(std::min(m_syncInterestLifetime,
+                                        m_rttEstimator.getRto(m_syncPrefix)));
 
   m_face.expressInterest(interest, bind(&Logic::onSyncData, this, _1, _2),
                          bind(&Logic::onSyncInterestTimeout, this, _1));
@@ -1602,7 +2720,8 @@ Logic::sendSyncInterest(RoundNo roundNo)
 void
 Logic::sendData(const Name& nodePrefix,
                 const Name& name,
-                DiffStatePtr diffState)
+                DiffStatePtr diffState,
+                DiffStatePtr roundState)
 {
   _LOG_DEBUG_ID(">> Logic::sendData");
   _LOG_DEBUG_ID("    nodePrefix: " << nodePrefix);
@@ -1611,16 +2730,15 @@ Logic::sendData(const Name& nodePrefix,
   shared_ptr<Data> data = make_shared<Data>(name);
 
   // Add cumulative info to data packet, if it exists
-  ConstBufferPtr cd;
-  RoundNo roundNo = 0;
   CumulativeInfoPtr cumulativeInfo = diffState->getCumulativeInfo();
   if (cumulativeInfo) {
-    cd = cumulativeInfo->second;
-    roundNo = cumulativeInfo->first;
-    printDigest(cd, "  Adding cumulative digest of round " + std::to_string(roundNo));
+    printDigest(cumulativeInfo->second,
+                "  Adding cumulative digest of round " + std::to_string(cumulativeInfo->first));
   }
 
-  DataContent dataContent (m_sessionName, roundNo, cd, diffState);
+  DataContent dataContent = cumulativeInfo ?
+    DataContent(m_sessionName, cumulativeInfo->first, cumulativeInfo->second, diffState) :
+    DataContent(m_sessionName, 0, diffState);
   if (!dataContent.wellFormed())
     throw Error ("Logic::sendData:: Malformed DataContent.");
 
@@ -1628,19 +2746,9 @@ Logic::sendData(const Name& nodePrefix,
 
   data->setFreshnessPeriod(m_dataFreshness);
 
-
-  if (m_defaultSigningId.empty())
-    m_keyChain.sign(*data);
-  else
-    m_keyChain.signByIdentity(*data, m_defaultSigningId);
-
-  // Update exclude filter in commit
-  _LOG_DEBUG_ID("    Update exclude filter with: " <<
-                data->getFullName().get(-1));
-  diffState->appendExclude(data->getFullName().get(-1));
-
-
-  m_face.put(*data);
+  // Exclude filter in commit is updated once the Data is signed
+  m_signingPipeline.sign(data, m_defaultSigningId,
+                         bind(&Logic::onDataSigned, this, _1, diffState, roundState));
 
 
   // checking if our own interest got satisfied
@@ -1656,6 +2764,24 @@ Logic::sendData(const Name& nodePrefix,
   _LOG_DEBUG_ID("<< Logic::sendData");
 }
 
+void
+Logic::onDataSigned(const shared_ptr<Data>& data,
+                    DiffStatePtr excludeState,
+                    DiffStatePtr roundState)
+{
+  if (excludeState) {
+    // Update exclude filter in commit
+    _LOG_DEBUG_ID("    Update exclude filter with: " <<
+                  data->getFullName().get(-1));
+    excludeState->appendExclude(data->getFullName().get(-1));
+  }
+
+  if (roundState)
+    roundState->setSignedData(data);
+
+  m_face.put(*data);
+}
+
 void
 Logic::sendRecoData(const Name& nodePrefix,
                     const Name& name)
@@ -1664,52 +2790,309 @@ Logic::sendRecoData(const Name& nodePrefix,
   _LOG_DEBUG_ID("    nodePrefix: " << nodePrefix);
   _LOG_DEBUG_ID("    name: " << name);
 
-  shared_ptr<Data> recoData = make_shared<Data>(name);
+  uint64_t segment = name.get(-1).toSegment();
+  Name recoName = name.getPrefix(-1);
+  size_t nExtra = recoName.size() - m_recoPrefix.size();
+
+  // The segments after the first are asked by transfer id, so that they all
+  // come from the segments built for the first one
+  std::map<uint64_t, RecoSegments>::iterator segmentsIter;
+  if (nExtra == 1 && recoName.get(-1).isVersion()) {
+    segmentsIter = m_recoSegments.find(recoName.get(-1).toVersion());
+    if (segmentsIter == m_recoSegments.end()) {
+      // The segments were forgotten: the requester times out and starts again
+      _LOG_DEBUG_ID("    no transfer " << recoName.get(-1).toVersion());
+      return;
+    }
+  }
+  else {
+    if (segment != 0) {
+      _LOG_DEBUG_ID("    segment " << segment << " without transfer id");
+      return;
+    }
+
+    // A retransmission of the first segment continues the transfer of the
+    // same name, unless the round has changed since
+    std::map<Name, uint64_t>::iterator transferIter = m_recoTransferIds.find(recoName);
+    segmentsIter = transferIter != m_recoTransferIds.end() ?
+      m_recoSegments.find(transferIter->second) : m_recoSegments.end();
+
+    if (segmentsIter == m_recoSegments.end() ||
+        segmentsIter->second.roundNo != m_currentRound - 1) {
+      if (m_recoSegments.size() >= MAX_RECO_TRANSFERS) {
+        _LOG_DEBUG_ID("    too many Reco Data transfers, ignoring " << recoName);
+        return;
+      }
+
+      segmentsIter = m_recoSegments.find(startRecoTransfer(recoName));
+    }
+  }
+
+  uint64_t transferId = segmentsIter->first;
+
+  // Keep the segments while they are being fetched
+  RecoSegments& recoSegments = segmentsIter->second;
+  m_scheduler.cancelEvent(recoSegments.expiryId);
+  recoSegments.expiryId =
+    m_scheduler.scheduleEvent(DEFAULT_RECO_SEGMENTS_LIFETIME,
+                              bind(&Logic::expireRecoSegments, this, transferId));
+
+  const RecoSegmentList& segments = *recoSegments.segments;
+  if (segment >= segments.size()) {
+    _LOG_DEBUG_ID("    no segment " << segment);
+    return;
+  }
 
-  // Send latest state corresponding to  m_currentRound - 1
-  DiffStatePtr state = make_shared<DiffState>();
-  *state += m_state;
-  RecoData sr (m_currentRound - 1, state);
+  _LOG_DEBUG_ID("    segment " << segment << " of " << segments.size() - 1);
 
+  RecoData sr (recoSegments.roundNo, segments[segment], recoSegments.baseRoundNo,
+               segment == 0 ? transferId : 0);
+
+  shared_ptr<Data> recoData = make_shared<Data>(name);
   recoData->setContent(sr.wireEncode());
+  recoData->setFinalBlockId(ndn::name::Component::fromSegment(segments.size() - 1));
   recoData->setFreshnessPeriod(m_dataFreshness);
 
-  if (m_defaultSigningId.empty())
-    m_keyChain.sign(*recoData);
-  else
-    m_keyChain.signByIdentity(*recoData, m_defaultSigningId);
-
-  m_face.put(*recoData);
+  m_signingPipeline.sign(recoData, m_defaultSigningId,
+                         bind(&Logic::onDataSigned, this, _1, DiffStatePtr(), DiffStatePtr()));
 
   _LOG_DEBUG_ID("<< Logic::sendRecoData");
 }
 
 
+uint64_t
+Logic::startRecoTransfer(const Name& recoName)
+{
+  size_t nExtra = recoName.size() - m_recoPrefix.size();
+
+  uint64_t transferId = m_nextRecoTransferId++;
+  RecoSegments& recoSegments = m_recoSegments[transferId];
+  recoSegments.recoName = recoName;
+  m_recoTransferIds[recoName] = transferId;
+
+  // If the requester sent its stable round and cumulative digest, and we
+  // agree on that digest, only send what changed after that round
+  DiffStatePtr state;
+  RoundNo baseRound = 0;
+  // Both components come from the requester: without a round number,
+  // fall through to the IBLT or the full state
+  if (nExtra >= 2 &&
+      recoName.get(m_recoPrefix.size()).isNumber() &&
+      recoName.get(m_recoPrefix.size() + 1).value_size() == Digest::SIZE) {
+    baseRound = recoName.get(m_recoPrefix.size()).toNumber();
+    state = getDiffSince(baseRound, Digest(recoName.get(m_recoPrefix.size() + 1)));
+    if (state)
+      _LOG_DEBUG_ID("    send changes after round " << baseRound);
+  }
+
+  // Otherwise, send the leaves in which we differ from the requester's IBLT
+  if (!state && (nExtra == 1 || nExtra == 3)) {
+    baseRound = 0;
+    try {
+      const ndn::name::Component& component = recoName.get(-1);
+      state = getDiffFromIblt(Iblt(Block(component.value(), component.value_size())));
+      if (state)
+        _LOG_DEBUG_ID("    send reconciled leaves");
+    }
+    catch (Iblt::Error&) {
+      _LOG_DEBUG_ID("    Malformed IBLT");
+    }
+    catch (ndn::tlv::Error&) {
+      _LOG_DEBUG_ID("    Malformed IBLT");
+    }
+  }
+
+  if (state) {
+    shared_ptr<RecoSegmentList> segments = make_shared<RecoSegmentList>();
+    splitRecoState(*state, *segments);
+    recoSegments.segments = segments;
+  }
+  else {
+    // Send latest state corresponding to  m_currentRound - 1
+    _LOG_DEBUG_ID("    send full state");
+    baseRound = 0;
+    recoSegments.segments = getFullStateSegments();
+  }
+
+  recoSegments.roundNo = m_currentRound - 1;
+  recoSegments.baseRoundNo = baseRound;
+
+  _LOG_DEBUG_ID("    transfer " << transferId << " of " <<
+                recoSegments.segments->size() << " segments");
+  return transferId;
+}
+
+void
+Logic::expireRecoSegments(uint64_t transferId)
+{
+  _LOG_DEBUG_ID("    Forget Reco Data segments of transfer " << transferId);
+
+  std::map<uint64_t, RecoSegments>::iterator segmentsIter = m_recoSegments.find(transferId);
+  if (segmentsIter == m_recoSegments.end())
+    return;
+
+  // The name may have a newer transfer already
+  std::map<Name, uint64_t>::iterator transferIter =
+    m_recoTransferIds.find(segmentsIter->second.recoName);
+  if (transferIter != m_recoTransferIds.end() && transferIter->second == transferId)
+    m_recoTransferIds.erase(transferIter);
+
+  m_recoSegments.erase(segmentsIter);
+
+  // Don't keep a split of m_state that no transfer uses
+  if (m_fullStateSegments && m_fullStateSegments.unique())
+    m_fullStateSegments.reset();
+}
+
+shared_ptr<const Logic::RecoSegmentList>
+Logic::getFullStateSegments()
+{
+  if (!m_fullStateSegments || m_fullStateDigest != m_state.getDigest()) {
+    shared_ptr<RecoSegmentList> segments = make_shared<RecoSegmentList>();
+    splitRecoState(m_state, *segments);
+    m_fullStateSegments = segments;
+    m_fullStateDigest = m_state.getDigest();
+  }
+
+  return m_fullStateSegments;
+}
+
 void
-Logic::printDigest(ndn::ConstBufferPtr digest, std::string name)
+Logic::splitRecoState(const State& state, std::vector<DiffStatePtr>& segments)
+{
+  // An empty state is still sent, in one empty segment
+  segments.push_back(make_shared<DiffState>());
+  size_t segmentSize = 0;
+
+  BOOST_FOREACH (ConstLeafRef leaf, state.getLeaves().get<ordered>())
+    {
+      // Name plus SeqNo and StateLeaf TLV headers
+      size_t leafSize = leaf->getSessionName().wireEncode().size() + 16;
+      if (segmentSize > 0 && segmentSize + leafSize > MAX_RECO_SEGMENT_SIZE) {
+        segments.push_back(make_shared<DiffState>());
+        segmentSize = 0;
+      }
+
+      segments.back()->update(leaf->getSessionKey(), leaf->getSeq());
+      segmentSize += leafSize;
+    }
+}
+
+DiffStatePtr
+Logic::getDiffSince(RoundNo baseRound, const Digest& cumulativeDigest)
+{
+  // We need our cumulative digest for baseRound, and every round after it
+  // with all its leaves
+  if (baseRound == 0 || baseRound > m_stableRound || baseRound < m_lastRecoveryRound ||
+      baseRound < m_compactedRound)
+    return NULL;
+
+  DiffStateContainer::iterator stateIter = m_log.find(baseRound);
+  if (stateIter == m_log.end() || (*stateIter)->getCumulativeDigest() != cumulativeDigest)
+    return NULL;
+
+  DiffStatePtr diff = make_shared<DiffState>();
+  for (++stateIter; stateIter != m_log.end(); ++stateIter) {
+    BOOST_FOREACH (ConstLeafRef leaf, (*stateIter)->getLeaves())
+      {
+        // CumulativeOnly entries are not data
+        if (leaf->getSeq() != CUMULATIVE_ONLY_DATA)
+          diff->update(leaf->getSessionKey(), leaf->getSeq());
+      }
+  }
+
+  return diff;
+}
+
+DiffStatePtr
+Logic::getDiffFromIblt(const Iblt& iblt)
 {
-  using namespace CryptoPP;
+  Iblt difference(iblt.getNCells(), m_state);
+  difference -= iblt;
+
+  std::vector<Iblt::Entry> ours;
+  std::vector<Iblt::Entry> theirs;
+  if (!difference.listEntries(ours, theirs)) {
+    _LOG_DEBUG_ID("    IBLT difference too big to decode");
+    return NULL;
+  }
+
+  _LOG_DEBUG_ID("    IBLT difference: " << ours.size() << " leaves only here, " <<
+                theirs.size() << " only there");
+
+  std::unordered_map<uint64_t, SeqNo> wanted;
+  BOOST_FOREACH (const Iblt::Entry& entry, ours)
+    {
+      wanted[entry.sessionHash] = entry.seq;
+    }
+
+  DiffStatePtr diff = make_shared<DiffState>();
+  if (wanted.empty())
+    return diff;
+
+  BOOST_FOREACH (ConstLeafRef leaf, m_state.getLeaves())
+    {
+      SessionKey key = leaf->getSessionKey();
+      std::unordered_map<uint64_t, SeqNo>::const_iterator it = wanted.find(key.hash);
+      if (it != wanted.end() && it->second == leaf->getSeq())
+        diff->update(key, leaf->getSeq());
+    }
+
+  return diff;
+}
 
+Name
+Logic::getRecoUserPrefix(const Name& name)
+{
+  // RECO is followed by at most the stable round, the cumulative digest
+  // and the IBLT, or by a transfer id
+  for (ssize_t i = 1; i <= 4 && i <= static_cast<ssize_t>(name.size()); ++i) {
+    if (RECO_INTEREST_COMPONENT != name.get(-i))
+      continue;
+
+    bool isRecoName = false;
+    switch (i) {
+    case 1:
+      isRecoName = true;
+      break;
+    case 2:
+      isRecoName = name.get(-1).isVersion() || isIbltComponent(name.get(-1));
+      break;
+    case 3:
+      isRecoName = name.get(-2).isNumber() && name.get(-1).value_size() == Digest::SIZE;
+      break;
+    case 4:
+      isRecoName = name.get(-3).isNumber() && name.get(-2).value_size() == Digest::SIZE &&
+                   isIbltComponent(name.get(-1));
+      break;
+    }
 
-  if (digest){
-    std::string hash;
-    StringSource(digest->buf(), digest->size(), true,
-                 new HexEncoder(new StringSink(hash), false));
-    std::cerr << "  " << name << ": " << hash << std::endl;
+    return isRecoName ? name.getPrefix(-i) : Name();
   }
+
+  return Name();
+}
+
+bool
+Logic::isIbltComponent(const ndn::name::Component& component)
+{
+  // The component holds the Iblt TLV, whose type fits in one byte
+  return component.value_size() > 0 && component.value()[0] == tlv::Iblt;
+}
+
+void
+Logic::printDigest(const Digest& digest, std::string name)
+{
+  if (!digest.isZero())
+    std::cerr << "  " << name << ": " << digest << std::endl;
   else
     std::cerr << "  " << name << ": " << "NULL" << std::endl;
 }
 
 std::string
-Logic::digestToStr(ndn::ConstBufferPtr digest)
+Logic::digestToStr(const Digest& digest)
 {
-  using namespace CryptoPP;
-
-  std::string hash;
-  StringSource(digest->buf(), digest->size(), true,
-               new HexEncoder(new StringSink(hash), false));
-  return hash;
+  return digest.toString();
 }
 
 } // namespace chronosync
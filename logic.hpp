@@ -29,6 +29,7 @@
 
 #include "boost-header.h"
 #include <memory>
+#include <map>
 #include <unordered_map>
 
 #include <ndn-cxx/face.hpp>
@@ -38,6 +39,11 @@
 
 //#include "interest-table.hpp"
 #include "diff-state-container.hpp"
+#include "state-store.hpp"
+#include "iblt.hpp"
+#include "signing-pipeline.hpp"
+#include "merkle-signature.hpp"
+#include "rtt-estimator.hpp"
 
 #include "ns3/ndnSIM-module.h"
 
@@ -101,6 +107,7 @@ public:
   static const time::milliseconds DEFAULT_DATA_FRESHNESS;
 
   static const time::milliseconds DEFAULT_ROUND_DIGEST_DELAY;
+  static const time::milliseconds MAX_ROUND_DIGEST_DELAY;
   static const time::milliseconds DEFAULT_STABILIZE_CUMULATIVE_DIGEST_DELAY;
 
   static const uint64_t MAX_ROUNDS_WITHOUT_RECOVERY;
@@ -118,6 +125,26 @@ public:
   static const int MAX_DATA_INTEREST_TIMEOUTS;
   static const int MAX_RECO_INTEREST_TIMEOUTS;
 
+  static const RoundNo DEFAULT_ROUND_LOG_COMPACT_WINDOW;
+  static const RoundNo DEFAULT_ROUND_LOG_DROP_WINDOW;
+
+  static const size_t DEFAULT_SNAPSHOT_LOG_SIZE;
+
+  static const size_t MAX_RECO_SEGMENT_SIZE;
+  static const size_t DEFAULT_RECO_PIPELINE_WINDOW;
+  static const time::milliseconds DEFAULT_RECO_SEGMENTS_LIFETIME;
+  static const size_t MAX_RECO_TRANSFERS;
+
+  static const size_t DEFAULT_RECO_IBLT_CELLS;
+
+  static const RoundNo MAX_DATA_INTEREST_RANGE;
+  static const size_t MAX_DATA_RANGE_SIZE;
+
+  static const RoundNo DEFAULT_SYNC_INTEREST_ROUNDS;
+
+  static const time::milliseconds DEFAULT_PUBLISH_COALESCING_WINDOW;
+  static const size_t DEFAULT_PUBLISH_COALESCING_COUNT;
+
   /**
    * @brief Constructor
    *
@@ -185,6 +212,8 @@ public:
    * @brief Update the seqNo of the local session
    *
    * The method updates the existing seqNo with the supplied seqNo and prefix.
+   * If publish coalescing is enabled (see setPublishCoalescing()), the new
+   * seqNo is committed in a round later, together with the next updates.
    *
    * @param seq The new seqNo.
    * @param updatePrefix The prefix of node to update.
@@ -193,12 +222,117 @@ public:
   updateSeqNo(const SeqNo& seq, const Name& updatePrefix = EMPTY_NAME);
 
 
+  /**
+   * @brief Fold the local updates into fewer rounds
+   *
+   * The updates received by updateSeqNo() within @p window of the first
+   * one, or until there are @p maxUpdates of them, are committed in a
+   * single round carrying the highest seqNo.  The other nodes learn the
+   * whole range of new seqNos through MissingDataInfo.
+   *
+   * A zero @p window or a @p maxUpdates of 1 commits every update in its
+   * own round (the default).
+   */
+  void
+  setPublishCoalescing(const time::milliseconds& window,
+                       size_t maxUpdates = DEFAULT_PUBLISH_COALESCING_COUNT);
+
+
 
   /// @brief Get root digest of current sync tree
   ndn::ConstBufferPtr
   getRootDigest() const;
 
 
+  /**
+   * @brief Set the retention policy of the round log
+   *
+   * Each time the stable round advances, rounds older than the stable round
+   * minus @p compactWindow are compacted: they only keep our own leaf, its
+   * cumulative info and the round and cumulative digests, which is what is
+   * needed to answer Data Interests and to compare cumulative digests.
+   * Rounds older than the stable round minus @p dropWindow are removed.
+   *
+   * Pass std::numeric_limits<RoundNo>::max() to never compact or drop rounds.
+   *
+   * @param compactWindow Number of rounds below the stable round kept whole
+   * @param dropWindow    Number of rounds below the stable round kept at all,
+   *                      must not be lower than compactWindow
+   */
+  void
+  setRoundLogRetention(RoundNo compactWindow, RoundNo dropWindow);
+
+  /// @brief Get the estimated number of bytes reclaimed from the round log so far
+  size_t
+  getRoundLogReclaimedBytes() const
+  {
+    return m_roundLogReclaimedBytes;
+  }
+
+
+  /**
+   * @brief Get the pipeline that signs the Data sent by this Logic
+   *
+   * It can be shared by the application, so that all the packets of a node
+   * are signed in order.
+   */
+  SigningPipeline&
+  getSigningPipeline()
+  {
+    return m_signingPipeline;
+  }
+
+
+  /**
+   * @brief Get the validator of the Data received by this Logic
+   *
+   * It can be shared by the application, so that the roots of batch signed
+   * packets are validated only once.
+   */
+  MerkleValidator&
+  getMerkleValidator()
+  {
+    return m_merkleValidator;
+  }
+
+
+  /**
+   * @brief Get the RTT estimates of the peers of this Logic
+   *
+   * Data Interests are measured under the sync prefix, and Reco Interests
+   * under the user prefix of each peer.  The application can add its own
+   * measurements (as Socket does, by session name).
+   */
+  RttEstimator&
+  getRttEstimator()
+  {
+    return m_rttEstimator;
+  }
+
+
+  /**
+   * @brief Persist the state of this Logic in @p directory
+   *
+   * If the directory holds a previous snapshot, the session name, seqNo,
+   * rounds, stable state and current state are restored from it and from the
+   * write-ahead log, and Data Interests are sent for the current round and
+   * the unstable rounds.  Otherwise a snapshot of the current (fresh) session
+   * is written.
+   *
+   * From then on every round log update is appended to the log, and a new
+   * snapshot is written after a recovery or when the log grows beyond
+   * DEFAULT_SNAPSHOT_LOG_SIZE bytes at a stabilization.
+   *
+   * It must be called before any data is published.  The application is not
+   * notified (through UpdateCallback) of the restored state.
+   *
+   * @param directory Directory of the store, created if it doesn't exist
+   * @throws StateStore::Error if the store can't be opened or read
+   */
+  void
+  enablePersistence(const std::string& directory);
+
+
 
 
 CHRONOSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
@@ -207,7 +341,7 @@ CHRONOSYNC_PUBLIC_WITH_TESTS_ELSE_PRIVATE:
 
 
   void
-  printState(std::ostream& os, State state) const;
+  printState(std::ostream& os, const State& state) const;
 
 
   ndn::Scheduler&
@@ -286,9 +420,12 @@ private:
    *
    * @param interest The Data Interest
    * @param data     The reply to the Data Interest
+   * @param sentTime When the Interest was sent, if its RTT must be measured
+   *                 (see RttEstimator), or time_point() otherwise
    */
   void
-  onData(const Interest& interest, Data& data);
+  onData(const Interest& interest, Data& data,
+         const time::steady_clock::time_point& sentTime);
 
 
   /**
@@ -313,9 +450,12 @@ private:
    *
    * @param interest The Reco Interest
    * @param data     The reply to the Reco Interest
+   * @param sentTime When the Interest was sent, if its RTT must be measured
+   *                 (see RttEstimator), or time_point() otherwise
    */
   void
-  onRecoData(const Interest& interest, Data& data);
+  onRecoData(const Interest& interest, Data& data,
+             const time::steady_clock::time_point& sentTime);
 
 
 
@@ -324,10 +464,13 @@ private:
    *
    * This method sends a Data Interest
    *
-   * @param interest The Data Interest
+   * @param interest    The Data Interest
+   * @param retries     Number of times the Interest has been sent
+   * @param isPastRound Whether the Interest was sent for a past round, with
+   *                    a lifetime from the RTT estimator
    */
   void
-  onDataInterestTimeout(const Interest& interest, unsigned retries);
+  onDataInterestTimeout(const Interest& interest, unsigned retries, bool isPastRound);
 
 
   /**
@@ -408,6 +551,19 @@ private:
   processDataInterest(const shared_ptr<const Interest>& interest);
 
 
+  /**
+   * @brief Process range Data Interest (/sync/DATA/<from>/<to>)
+   *
+   * This method replies with a MultiRoundContent with our contribution
+   * to each round of the range, if we have any. The content stops before
+   * the round that would make it exceed MAX_DATA_RANGE_SIZE bytes.
+   *
+   * @param interest          The incoming interest
+   */
+  void
+  processDataRangeInterest(const shared_ptr<const Interest>& interest);
+
+
   /**
    * @brief Updates m_currentRound to newCurrentRound and sends Data Interests
    *
@@ -458,18 +614,50 @@ private:
 
 
   /**
-   * @brief              Performs fishing in roundNo if roundDigest != the one
-   *                     in rounds log
+   * @brief              Applies the round log retention policy
+   *
+   * Compacts and drops the rounds of m_log that are far enough below
+   * m_stableRound (see setRoundLogRetention).
+   *
+   * @return estimated number of bytes reclaimed
+   */
+  size_t
+  collectRoundLog ();
+
+
+  /**
+   * @brief              Restores the state from a store (see enablePersistence)
    *
+   * @return false if the store has no snapshot
+   */
+  bool
+  restoreFromStore (StateStore& store);
+
+
+  /**
+   * @brief              Writes a snapshot of the state to m_store, followed by
+   *                     the rounds of m_log that are not stable yet
+   */
+  void
+  writeSnapshot ();
+
+
+  /**
+   * @brief              Performs fishing in the rounds whose round digest
+   *                     != the one in rounds log
    *
-   * @param roundNo      The round # where to check if fishing needed
+   * Rounds before m_lastRecoveryRound or from m_currentRound on are not
+   * checked. The rounds to fish are fetched with sendDataInterests.
    *
-   * @param roundDigest  round digest of remote peer for roundNo
+   * @param firstRound   The round of the first digest
    *
-   * @return true if equal round digests, false otherwise
+   * @param roundDigests round digests of remote peer for firstRound and
+   *                     the following rounds
+   *
+   * @return true if all the checked round digests are equal, false otherwise
    */
   bool
-  checkRoundDigests (RoundNo roundNo, const ndn::ConstBufferPtr roundDigest);
+  checkRoundDigests (RoundNo firstRound, const std::vector<Digest>& roundDigests);
 
 
   /**
@@ -482,7 +670,7 @@ private:
    *
    */
   void
-  produceCumulativeOnly(RoundNo roundNo, ndn::ConstBufferPtr cumulativeDigest);
+  produceCumulativeOnly(RoundNo roundNo, const Digest& cumulativeDigest);
 
 
   /**
@@ -495,9 +683,12 @@ private:
    *
    * @param cumulativeDigest	The cumulative digest for roundNo
    *
+   * @param roundState       	If not NULL, the round log entry that caches the signed Data
+   *
    */
   void
-  sendCumulativeOnly(ndn::Name name, RoundNo roundNo, ndn::ConstBufferPtr cumulativeDigest);
+  sendCumulativeOnly(ndn::Name name, RoundNo roundNo, const Digest& cumulativeDigest,
+                     DiffStatePtr roundState = DiffStatePtr());
 
 
   /**
@@ -514,11 +705,16 @@ private:
   void
   checkRecovery(ndn::Name userPrefix,
                 RoundNo roundNoOfCumulativeDigest,
-                ndn::ConstBufferPtr cumulativeDigest);
+                const Digest& cumulativeDigest);
 
 
   /**
-   * @brief Send Recovery Interest to a userPrefix
+   * @brief Start fetching the Reco Data of a userPrefix
+   *
+   * Reco Data is segmented: this method sends the Interest for the first
+   * segment, whose FinalBlockId tells how many segments there are.  The
+   * rest are fetched by sendRecoSegmentInterests with a window of
+   * DEFAULT_RECO_PIPELINE_WINDOW Interests.
    *
    *
    * @param userPrefix         	The Recovery Interest will be sent to userPrefix
@@ -529,6 +725,88 @@ private:
   sendRecoInterest(ndn::Name userPrefix);
 
 
+  /**
+   * @brief Start searching the last round in which our cumulative digest
+   *        is the same as the one of userPrefix
+   *
+   * The rounds of m_log with a reliable cumulative digest before
+   * @p differingRound are bisected by asking userPrefix for its cumulative
+   * digest (Cumulative Digest Interest, <userPrefix>/RECO/CD/<round>).
+   *
+   * @param userPrefix     The peer whose cumulative digest differs
+   * @param differingRound The round in which the cumulative digests differ
+   *
+   * @return false if there is no round to bisect, the caller should then
+   *         send a Reco Interest
+   */
+  bool
+  startBisection(const Name& userPrefix, RoundNo differingRound);
+
+
+  /// @brief Ask userPrefix for its cumulative digest in the next round to bisect
+  void
+  sendCumulativeDigestInterest(const Name& userPrefix);
+
+
+  /**
+   * @brief Narrow the bisection with userPrefix
+   *
+   * @param roundNo The round probed
+   * @param isSame  Whether the cumulative digests of both nodes are the same
+   *                in roundNo
+   */
+  void
+  continueBisection(const Name& userPrefix, RoundNo roundNo, bool isSame);
+
+
+  /**
+   * @brief End the bisection with userPrefix
+   *
+   * If a common round was found, the rounds after it are fetched again with
+   * Data Interests and the stable state is restarted as after a recovery.
+   * Otherwise (the common round is no longer in m_log) a Reco Interest is
+   * sent.
+   */
+  void
+  finishBisection(const Name& userPrefix);
+
+
+  /// @brief Callback to handle the reply to a Cumulative Digest Interest
+  void
+  onCumulativeDigestData(const Interest& interest, Data& data);
+
+
+  /// @brief Callback to handle a valid reply to a Cumulative Digest Interest
+  void
+  onCumulativeDigestDataValidated(const shared_ptr<const Data>& data);
+
+
+  /// @brief Callback to handle an invalid reply to a Cumulative Digest Interest
+  void
+  onCumulativeDigestDataValidationFailed(const shared_ptr<const Data>& data);
+
+
+  /**
+   * @brief Callback to handle Cumulative Digest Interest timeout
+   *
+   * The peer doesn't have a cumulative digest for the round (or is not
+   * reachable), so the round is taken as different.
+   */
+  void
+  onCumulativeDigestInterestTimeout(const Interest& interest);
+
+
+  /**
+   * @brief Process Cumulative Digest Interest
+   *
+   * If we have a reliable cumulative digest for the requested round, it is
+   * sent back in a CumulativeOnly DataContent. Otherwise the Interest is not
+   * answered.
+   */
+  void
+  processCumulativeDigestInterest(const shared_ptr<const Interest>& interest);
+
+
  /**
    * @brief Process Sync Interest
    *
@@ -571,31 +849,97 @@ private:
 
 
   /**
-   * @brief Process Reco Data.
+   * @brief Process the reply to a range Data Interest
    *
-   * This method extracts state update information from Reco Data and applies
-   * it to the state. If roundNo of Reco Data is greater than m_currenRound, then
-   * move to this roundNo and update m_currentRound.
+   * Each round of the MultiRoundContent is processed as a Data of that
+   * round, and the range Data Interest is re-expressed excluding this reply
+   * to get the contributions of other producers. If the reply was truncated,
+   * the rounds left out are asked again.
    *
-   * @param fullName    The full data name of Data, including implicit digest
+   * @param fullName        The full data name of Data, including implicit digest
    *
-   * @param dataBlock The content of the Data
+   * @param multiRoundBlock The content of the Data
+   */
+  void
+  processDataRange(const Name& fullName,
+                   const Block& multiRoundBlock);
+
+
+  /**
+   * @brief Apply the DataContent received for a round
+   *
+   * @param roundNo          The round of the DataContent
+   *
+   * @param implicitDigest   The implicit digest of the Data to add to the
+   *                         exclude filter of the round, empty if none
+   *
+   * @param dataContentBlock The DataContent
+   */
+  void
+  processRoundData(RoundNo roundNo,
+                   const ndn::name::Component& implicitDigest,
+                   const Block& dataContentBlock);
+
+
+  /**
+   * @brief Process a segment of Reco Data.
+   *
+   * This method extracts state update information from the segment and
+   * applies it to the state, then requests the next segments. Once all the
+   * segments have been received, finishRecovery is called.
+   *
+   * @param fullName     The full data name of Data, including implicit digest
+   *
+   * @param recoBlock    The content of the Data
+   *
+   * @param finalSegment The FinalBlockId of the Data
    *
    */
 
   void
   processRecoData(const Name& fullName,
-                  const Block& recoBlock);
+                  const Block& recoBlock,
+                  uint64_t finalSegment);
+
+
+  /**
+   * @brief Apply the end of a recovery once all the Reco Data segments are in
+   *
+   * If roundNo of Reco Data is greater than m_currenRound, then move to this
+   * roundNo and update m_currentRound. The stable state is restarted from the
+   * recovered state.
+   *
+   * @param roundNoOfState The greatest roundNo of the received segments
+   */
+  void
+  finishRecovery(RoundNo roundNoOfState);
+
+
+  /// @brief Send Reco Interests for the next segments that fit in the window
+  void
+  sendRecoSegmentInterests(const Name& userPrefix);
+
+
+  /// @brief Send the Reco Interest of one segment
+  void
+  sendRecoSegmentInterest(const Name& userPrefix, uint64_t segment);
 
 
   /**
    * @brief Insert state diff into log
    *
+   * If the round is already in the log and @p commit is not its entry,
+   * @p commit is merged into the entry.  Only what this call added is
+   * appended to the persistent store.
+   *
    * @param diff         The diff.
    * @param roundNo      The round to update / insert
+   * @param added        The leaves added to @p commit by the caller, if
+   *                     @p commit is the existing entry of the round
    */
   void
-  updateDiffLog(DiffStatePtr commit, const RoundNo roundNo);
+  updateDiffLog(DiffStatePtr commit, const RoundNo roundNo,
+                DiffStatePtr added = DiffStatePtr());
 
 
   /**
@@ -615,34 +959,194 @@ private:
   sendDataInterest(RoundNo roundNo, unsigned retries = 1);
 
 
+  /**
+   * @brief Fetch rounds @p from to @p to (both included)
+   *
+   * The rounds are asked with range Data Interests of at most
+   * MAX_DATA_INTEREST_RANGE rounds, or a Data Interest for a single round.
+   */
+  void
+  sendDataInterests(RoundNo from, RoundNo to);
+
+
+  /// @brief Method to send a range Data Interest
+  void
+  sendDataRangeInterest(RoundNo from, RoundNo to, unsigned retries);
+
+
+  /**
+   * @brief Callback to handle range Data Interest timeout
+   *
+   * The Interest is sent again until a first reply is received, then a
+   * timeout means there are no more producers in the range.
+   */
+  void
+  onDataRangeInterestTimeout(const Interest& interest, unsigned retries);
+
+
+  /**
+   * @brief Commit m_seqNo in the current round and move to the next one
+   */
+  void
+  commitSeqNo();
+
+
+  /**
+   * @brief Announce the round digest of roundNo in the next Sync Interest
+   *
+   * Rounds are coalesced: the Sync Interests are sent
+   * DEFAULT_ROUND_DIGEST_DELAY after the first pending round, or now if
+   * @p isImmediate. Scheduling a round that is already pending restarts
+   * the delay, up to MAX_ROUND_DIGEST_DELAY after the first pending round.
+   */
+  void
+  scheduleSyncInterest(RoundNo roundNo, bool isImmediate = false);
+
+
+  /// @brief Send the Sync Interests covering the pending rounds
+  void
+  sendSyncInterests();
+
+
    /**
    * @brief Method to send Sync Interest
    *
-   * @param roundNo   The Sync Interest includes the round digest for the roundNo.
+   * The Sync Interest name is /sync/SYNC/<lastRound>/<digests>, digests
+   * being the round digests of firstRound to lastRound, oldest first.
    *
    */
   void
-  sendSyncInterest(RoundNo roundNo);
+  sendSyncInterest(RoundNo firstRound, RoundNo lastRound);
 
 
-  /// @brief Helper method to send Data
+  /**
+   * @brief Helper method to send Data
+   *
+   * The Data is put once signed by m_signingPipeline.  If @p roundState is
+   * not NULL, the signed Data is cached in it to answer the same Interest.
+   */
   void
   sendData(const Name& nodePrefix,
                const Name& name,
-               DiffStatePtr diffState);
+               DiffStatePtr diffState,
+               DiffStatePtr roundState = DiffStatePtr());
 
 
-  /// @brief Helper method to send Reco Data
+  /**
+   * @brief Put a Data signed by m_signingPipeline
+   *
+   * @param excludeState if not NULL, the Data is appended to its exclude filter
+   * @param roundState   if not NULL, the Data is cached in it
+   */
+  void
+  onDataSigned(const shared_ptr<Data>& data,
+               DiffStatePtr excludeState,
+               DiffStatePtr roundState);
+
+
+  typedef std::vector<DiffStatePtr> RecoSegmentList;
+
+  /**
+   * @brief Helper method to send a segment of Reco Data
+   *
+   * The segments are built when segment 0 is requested, under a new
+   * transfer id sent in that segment. The requester asks for the other
+   * segments with <userPrefix>/RECO/<transferId as version>/<segment>, so
+   * the IBLT is only sent once and all the segments of a transfer come from
+   * the same state. The segments are kept until none is requested for
+   * DEFAULT_RECO_SEGMENTS_LIFETIME.
+   *
+   * A first segment asked again with the same name, in the same round,
+   * gets the same transfer. The transfers of the full state share one
+   * split of m_state. At most MAX_RECO_TRANSFERS transfers are kept.
+   *
+   * @param name Reco Interest name, ending with the segment number
+   */
   void
   sendRecoData(const Name& nodePrefix,
                const Name& name);
 
 
+  /**
+   * @brief Build the segments answering a Reco name under a new transfer id
+   *
+   * @param recoName Reco Interest name without the segment number
+   *
+   * @return the transfer id
+   */
+  uint64_t
+  startRecoTransfer(const Name& recoName);
+
+
+  /// @brief Forget the segments built for a Reco Data transfer
+  void
+  expireRecoSegments(uint64_t transferId);
+
+
+  /// @brief Get the segments of m_state, splitting it only if it changed
+  shared_ptr<const RecoSegmentList>
+  getFullStateSegments();
+
+
+  /**
+   * @brief Split the leaves of @p state in segments of at most
+   *        MAX_RECO_SEGMENT_SIZE encoded bytes
+   */
+  void
+  splitRecoState(const State& state, std::vector<DiffStatePtr>& segments);
+
+
+  /**
+   * @brief Merge the rounds of m_log after @p baseRound (delta recovery)
+   *
+   * @param baseRound        Stable round of the requester
+   * @param cumulativeDigest Cumulative digest of the requester for baseRound
+   *
+   * @return the leaves changed after baseRound, or NULL if our cumulative
+   *         digest for baseRound is unknown or different, or if the rounds
+   *         after it are no longer complete in m_log
+   */
+  DiffStatePtr
+  getDiffSince(RoundNo baseRound, const Digest& cumulativeDigest);
+
+
+  /**
+   * @brief Reconcile m_state with the IBLT of the requester's state
+   *
+   * @param iblt IBLT of the requester's m_state
+   *
+   * @return our leaves that the requester lacks or has with an older seqNo,
+   *         or NULL if the difference is too big to decode
+   */
+  DiffStatePtr
+  getDiffFromIblt(const Iblt& iblt);
+
+
+  /**
+   * @brief Extract the user prefix of a Reco Interest name
+   *
+   * Reco names (without the segment number) are
+   * <userPrefix>/RECO[/<stableRound>/<cumulativeDigest>][/<iblt>]: the
+   * stable round and cumulative digest ask for a delta, the IBLT of the
+   * requester's state asks for a reconciliation. The segments after the
+   * first are asked with <userPrefix>/RECO/<transferId as version>.
+   *
+   * @return the user prefix, or an empty name if @p name is not a Reco name
+   */
+  static Name
+  getRecoUserPrefix(const Name& name);
+
+
+  /// @brief Check that a Reco name component holds an encoded IBLT
+  static bool
+  isIbltComponent(const ndn::name::Component& component);
+
+
   void
-  printDigest(ndn::ConstBufferPtr digest, std::string name = "digest");
+  printDigest(const Digest& digest, std::string name = "digest");
 
   std::string
-  digestToStr(ndn::ConstBufferPtr digest);
+  digestToStr(const Digest& digest);
 
 public:
   static const ndn::Name DEFAULT_NAME;
@@ -652,12 +1156,50 @@ public:
 private:
   typedef std::unordered_map<ndn::Name, NodeInfo> NodeList;
 
-  static const ndn::ConstBufferPtr EMPTY_DIGEST;
+  /// @brief Segments of the Reco Data served for a Reco name
+  struct RecoSegments
+  {
+    // Reco name of the first segment, without the segment number
+    Name recoName;
+    RoundNo roundNo;
+    RoundNo baseRoundNo;
+    // Shared by the transfers of the full state
+    shared_ptr<const RecoSegmentList> segments;
+    ndn::EventId expiryId;
+  };
+
+  /// @brief Reco Data being fetched from a user prefix
+  struct RecoFetch
+  {
+    RecoFetch()
+      : hasFinalSegment(false)
+      , finalSegment(0)
+      , nextSegment(0)
+      , roundNo(0)
+      , timeouts(0)
+    {
+    }
+
+    // Reco name without the segment number, the transfer name once the
+    // first segment is received
+    Name name;
+    bool hasFinalSegment;
+    uint64_t finalSegment;
+    // First segment not requested yet
+    uint64_t nextSegment;
+    // Segments requested and not received yet
+    std::set<uint64_t> pendingSegments;
+    // Greatest roundNo of the received segments
+    RoundNo roundNo;
+    // Consecutive timeouts
+    unsigned timeouts;
+  };
 
   // name components
   static const ndn::name::Component DATA_INTEREST_COMPONENT;
   static const ndn::name::Component SYNC_INTEREST_COMPONENT;
   static const ndn::name::Component RECO_INTEREST_COMPONENT;
+  static const ndn::name::Component CUMULATIVE_INTEREST_COMPONENT;
 
   // Communication
   ndn::Face& m_face;
@@ -708,9 +1250,25 @@ private:
   // be required.
   bool m_recoveryDesired;
 
+  // Round log retention (see setRoundLogRetention)
+  RoundNo m_roundLogCompactWindow;
+  RoundNo m_roundLogDropWindow;
+
+  // Rounds <= m_compactedRound have been compacted in m_log
+  RoundNo m_compactedRound;
+
+  // Rounds <= m_droppedRound have been removed from m_log, their cumulative
+  // digests can't be compared any more
+  RoundNo m_droppedRound;
+
+  size_t m_roundLogReclaimedBytes;
+
+  // Persistence, NULL if disabled
+  scoped_ptr<StateStore> m_store;
+
 
   // Map that contain cumulativeDigest and the programmed event to send this cumulativeDigest.
-  std::map<ndn::Buffer, ndn::EventId> m_cumulativeDigestToEventId;
+  std::unordered_map<Digest, ndn::EventId, DigestHash> m_cumulativeDigestToEventId;
 
   // Callback
   UpdateCallback m_onUpdate;
@@ -739,13 +1297,73 @@ private:
   // Security
   ndn::Name m_defaultSigningId;
   ndn::KeyChain& m_keyChain;
+  SigningPipeline m_signingPipeline;
   ndn::shared_ptr<ndn::Validator> m_validator;
+  MerkleValidator m_merkleValidator;
+
+  // Drives the lifetime and re-expression of Interests, initially
+  // m_dataInterestLifetime
+  RttEstimator m_rttEstimator;
+
+  // Publish coalescing
+  time::milliseconds m_publishCoalescingWindow;
+  size_t m_publishCoalescingCount;
+  // Updates of m_seqNo not committed in a round yet
+  size_t m_pendingSeqUpdates;
+  ndn::EventId m_commitSeqNoId;
 
   unsigned m_numberDataInterestTimeouts;
-  unsigned m_numberRecoInterestTimeouts;
 
   std::set<ndn::Name>  m_pendingRecoveryPrefixes;
 
+  /// @brief Search of the last round with the same cumulative digest as a peer
+  struct Bisection
+  {
+    // Rounds of m_log with a cumulative digest to compare, in increasing order
+    std::vector<RoundNo> rounds;
+    // rounds[low] is the greatest round known to be the same, -1 if none
+    ssize_t low;
+    // rounds[high] is the lowest round known to differ, rounds.size() if none
+    ssize_t high;
+    // m_lastRecoveryRound when the search started: a recovery in the
+    // meantime recomputes the cumulative digests
+    RoundNo lastRecoveryRound;
+  };
+
+  // Rounds to announce in the next Sync Interests
+  std::set<RoundNo> m_syncRounds;
+  // Whether they are sent now, instead of after DEFAULT_ROUND_DIGEST_DELAY
+  bool m_isSyncImmediate;
+  // Latest time to send them, however much data the pending rounds get
+  time::steady_clock::time_point m_syncDeadline;
+
+  // Replies received to the range Data Interests in progress, by range
+  std::map<std::pair<RoundNo, RoundNo>, ndn::Exclude> m_dataRangeExcludes;
+
+  // Bisections in progress, by user prefix
+  std::map<ndn::Name, Bisection> m_bisections;
+
+  // m_lastRecoveryRound set by the last bisection with each user prefix:
+  // if the cumulative digests still differ after it, re-fetching the
+  // rounds did not converge and a Reco Data is needed
+  std::map<ndn::Name, RoundNo> m_bisectedPrefixes;
+
+  // Reco Data being fetched, by user prefix
+  std::map<ndn::Name, RecoFetch> m_recoFetches;
+
+  // Reco Data being served, by transfer id
+  std::map<uint64_t, RecoSegments> m_recoSegments;
+  // Transfer started for each Reco name, so that a retransmitted first
+  // segment doesn't start another one
+  std::map<ndn::Name, uint64_t> m_recoTransferIds;
+  // Latest split of m_state, shared by the full state transfers, and the
+  // digest of the state it was split from
+  shared_ptr<const RecoSegmentList> m_fullStateSegments;
+  Digest m_fullStateDigest;
+  // Id of the next Reco Data transfer, starting at a random value so that
+  // ids don't repeat across restarts
+  uint64_t m_nextRecoTransferId;
+
 #ifdef _DEBUG
   int m_instanceId;
   static int m_instanceCounter;
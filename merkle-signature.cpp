@@ -0,0 +1,293 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "tlv.hpp"
+
+#include "merkle-signature.hpp"
+
+namespace chronosync {
+
+// Experimental SignatureType value for batch signed packets
+const uint32_t MerkleSignature::SIGNATURE_TYPE(200);
+
+const name::Component MerkleSignature::ROOT_COMPONENT("MERKLE");
+
+// Number of trusted roots remembered by a MerkleValidator
+const size_t MerkleValidator::DEFAULT_MAX_ROOTS(1024);
+
+// A proof longer than this can't come from a batch we could build
+static const size_t MAX_PROOF_SIZE = 32;
+
+MerkleTree::MerkleTree(const std::vector<Digest>& leaves)
+{
+  BOOST_ASSERT(!leaves.empty());
+
+  m_levels.push_back(leaves);
+  while (m_levels.back().size() > 1) {
+    const std::vector<Digest>& level = m_levels.back();
+
+    std::vector<Digest> parents;
+    parents.reserve((level.size() + 1) / 2);
+    for (size_t i = 0; i < level.size(); i += 2)
+      parents.push_back(combine(level[i], i + 1 < level.size() ? level[i + 1] : level[i]));
+
+    m_levels.push_back(parents);
+  }
+}
+
+std::vector<Digest>
+MerkleTree::getProof(size_t index) const
+{
+  BOOST_ASSERT(index < m_levels.front().size());
+
+  std::vector<Digest> proof;
+  for (size_t i = 0; i + 1 < m_levels.size(); ++i) {
+    const std::vector<Digest>& level = m_levels[i];
+    size_t sibling = index ^ 1;
+    proof.push_back(sibling < level.size() ? level[sibling] : level[index]);
+    index >>= 1;
+  }
+  return proof;
+}
+
+Digest
+MerkleTree::computeRoot(const Digest& leaf, uint64_t index, const std::vector<Digest>& proof)
+{
+  Digest node = leaf;
+  BOOST_FOREACH (const Digest& sibling, proof)
+    {
+      node = (index & 1) ? combine(sibling, node) : combine(node, sibling);
+      index >>= 1;
+    }
+  return node;
+}
+
+Digest
+MerkleTree::computeLeaf(const Data& data)
+{
+  ndn::EncodingBuffer encoder;
+  data.wireEncode(encoder, true);
+  return Digest::sha256(encoder.buf(), encoder.size());
+}
+
+Digest
+MerkleTree::combine(const Digest& left, const Digest& right)
+{
+  // The 0x01 prefix tells inner nodes from leaves, which start with the
+  // Name TLV of the packet
+  uint8_t buffer[1 + 2 * Digest::SIZE];
+  buffer[0] = 0x01;
+  std::memcpy(buffer + 1, left.data(), Digest::SIZE);
+  std::memcpy(buffer + 1 + Digest::SIZE, right.data(), Digest::SIZE);
+  return Digest::sha256(buffer, sizeof(buffer));
+}
+
+MerkleSignature::MerkleSignature(uint64_t index, const shared_ptr<const Data>& rootData,
+                                 const std::vector<Digest>& proof)
+  : m_index(index)
+  , m_rootData(rootData)
+  , m_proof(proof)
+{
+}
+
+MerkleSignature::MerkleSignature(const Data& data)
+{
+  if (!isMerkleSigned(data))
+    throw Error("Not a batch signature");
+
+  const Block& value = data.getSignature().getValue();
+  value.parse();
+
+  Block::element_const_iterator it = value.elements_begin();
+  if (it == value.elements_end() || it->type() != tlv::MerkleLeafIndex)
+    throw Error("Expecting MerkleLeafIndex in batch signature");
+  m_index = readNonNegativeInteger(*it);
+  it++;
+
+  if (it == value.elements_end() || it->type() != ndn::tlv::Data)
+    throw Error("Expecting root Data in batch signature");
+  m_rootData = make_shared<Data>(*it);
+  it++;
+
+  for (; it != value.elements_end(); it++) {
+    if (it->type() != tlv::MerkleProofHash || it->value_size() != Digest::SIZE)
+      throw Error("Expecting MerkleProofHash in batch signature");
+    m_proof.push_back(Digest(it->value(), it->value_size()));
+  }
+
+  if (m_proof.size() > MAX_PROOF_SIZE)
+    throw Error("Merkle proof too long");
+
+  const Name& rootName = m_rootData->getName();
+  if (rootName.size() < 2 || rootName.get(-2) != ROOT_COMPONENT ||
+      rootName.get(-1).value_size() != Digest::SIZE)
+    throw Error("Malformed root Data name " + rootName.toUri());
+}
+
+ndn::SignatureInfo
+MerkleSignature::getSignatureInfo()
+{
+  return ndn::SignatureInfo(static_cast<ndn::tlv::SignatureTypeValue>(SIGNATURE_TYPE));
+}
+
+Name
+MerkleSignature::getRootName(const Name& prefix, const Digest& root)
+{
+  Name rootName(prefix);
+  rootName.append(ROOT_COMPONENT).append(root.toComponent());
+  return rootName;
+}
+
+ndn::Signature
+MerkleSignature::getSignature() const
+{
+  ndn::EncodingBuffer buffer;
+  size_t totalLength = 0;
+
+  BOOST_REVERSE_FOREACH (const Digest& sibling, m_proof)
+    {
+      totalLength += prependByteArrayBlock(buffer, tlv::MerkleProofHash,
+                                           sibling.data(), sibling.size());
+    }
+  totalLength += prependBlock(buffer, m_rootData->wireEncode());
+  totalLength += prependNonNegativeIntegerBlock(buffer, tlv::MerkleLeafIndex, m_index);
+
+  totalLength += buffer.prependVarNumber(totalLength);
+  totalLength += buffer.prependVarNumber(ndn::tlv::SignatureValue);
+
+  return ndn::Signature(getSignatureInfo(), buffer.block());
+}
+
+Digest
+MerkleSignature::getRoot() const
+{
+  return Digest(m_rootData->getName().get(-1));
+}
+
+bool
+MerkleSignature::verifyProof(const Data& data) const
+{
+  // The key of the root Data can only vouch for packets under its prefix
+  if (!m_rootData->getName().getPrefix(-2).isPrefixOf(data.getName()))
+    return false;
+
+  return MerkleTree::computeRoot(MerkleTree::computeLeaf(data), m_index, m_proof) == getRoot();
+}
+
+MerkleValidator::MerkleValidator(size_t maxRoots, size_t maxValidatedNames)
+  : m_maxRoots(maxRoots)
+  , m_validatedNames(maxValidatedNames)
+{
+}
+
+void
+MerkleValidator::validate(const Data& data,
+                          const shared_ptr<ndn::Validator>& validator,
+                          const ndn::OnDataValidated& onValidated,
+                          const ndn::OnDataValidationFailed& onValidationFailed)
+{
+  shared_ptr<const Data> dataPtr = data.shared_from_this();
+
+  if (!static_cast<bool>(validator) && !MerkleSignature::isMerkleSigned(data)) {
+    onValidated(dataPtr);
+    return;
+  }
+
+  // The same packet was already validated
+  if (m_validatedNames.contains(data.getFullName())) {
+    onValidated(dataPtr);
+    return;
+  }
+
+  if (!MerkleSignature::isMerkleSigned(data)) {
+    validator->validate(data,
+                        bind(&MerkleValidator::onDataValidated, this, _1, onValidated),
+                        onValidationFailed);
+    return;
+  }
+
+  try {
+    MerkleSignature signature(data);
+    if (!signature.verifyProof(data)) {
+      onValidationFailed(dataPtr, "Merkle proof does not match the root");
+      return;
+    }
+
+    Digest root = signature.getRoot();
+    if (!static_cast<bool>(validator) || m_roots.find(root) != m_roots.end()) {
+      onValidated(dataPtr);
+      return;
+    }
+
+    validator->validate(*signature.getRootData(),
+                        bind(&MerkleValidator::onRootValidated, this,
+                             dataPtr, root, onValidated),
+                        bind(&MerkleValidator::onRootValidationFailed, this,
+                             dataPtr, _2, onValidationFailed));
+  }
+  catch (MerkleSignature::Error& e) {
+    onValidationFailed(dataPtr, e.what());
+  }
+  catch (ndn::tlv::Error& e) {
+    onValidationFailed(dataPtr, e.what());
+  }
+}
+
+void
+MerkleValidator::onDataValidated(const shared_ptr<const Data>& data,
+                                 const ndn::OnDataValidated& onValidated)
+{
+  m_validatedNames.insert(data->getFullName());
+  onValidated(data);
+}
+
+void
+MerkleValidator::onRootValidated(const shared_ptr<const Data>& data,
+                                 const Digest& root,
+                                 const ndn::OnDataValidated& onValidated)
+{
+  addRoot(root);
+  onDataValidated(data, onValidated);
+}
+
+void
+MerkleValidator::onRootValidationFailed(const shared_ptr<const Data>& data,
+                                        const std::string& failureInfo,
+                                        const ndn::OnDataValidationFailed& onValidationFailed)
+{
+  onValidationFailed(data, "Root Data: " + failureInfo);
+}
+
+void
+MerkleValidator::addRoot(const Digest& root)
+{
+  if (m_maxRoots == 0 || !m_roots.insert(root).second)
+    return;
+
+  m_rootOrder.push_back(root);
+  if (m_rootOrder.size() > m_maxRoots) {
+    m_roots.erase(m_rootOrder.front());
+    m_rootOrder.pop_front();
+  }
+}
+
+} // namespace chronosync
@@ -0,0 +1,240 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_MERKLE_SIGNATURE_HPP
+#define CHRONOSYNC_MERKLE_SIGNATURE_HPP
+
+#include "digest.hpp"
+#include "validation-cache.hpp"
+
+#include <deque>
+
+#include <ndn-cxx/security/validator.hpp>
+
+namespace chronosync {
+
+/**
+ * @brief Merkle tree over the digests of a batch of packets
+ *
+ * Leaves are the SHA-256 of the signed portion of each packet.  An inner
+ * node is the SHA-256 of 0x01 followed by its two children; a node without
+ * sibling is paired with itself.
+ */
+class MerkleTree
+{
+public:
+  /**
+   * @param leaves leaf digests, at least one
+   */
+  explicit
+  MerkleTree(const std::vector<Digest>& leaves);
+
+  const Digest&
+  getRoot() const
+  {
+    return m_levels.back().front();
+  }
+
+  /**
+   * @brief Sibling digests from leaf @p index up to the root
+   */
+  std::vector<Digest>
+  getProof(size_t index) const;
+
+  /**
+   * @brief Root obtained by combining @p leaf, at position @p index, with @p proof
+   */
+  static Digest
+  computeRoot(const Digest& leaf, uint64_t index, const std::vector<Digest>& proof);
+
+  /**
+   * @brief Leaf digest of @p data: SHA-256 of its signed portion
+   *
+   * The SignatureInfo of @p data must be set.
+   */
+  static Digest
+  computeLeaf(const Data& data);
+
+private:
+  static Digest
+  combine(const Digest& left, const Digest& right);
+
+private:
+  // m_levels[0] are the leaves, m_levels.back() the root
+  std::vector<std::vector<Digest> > m_levels;
+};
+
+/**
+ * @brief Signature of a packet signed as part of a batch
+ *
+ * The SignatureValue carries the index of the packet in the batch, the
+ * root Data and the Merkle proof:
+ *
+ *     SignatureValue ::= SIGNATURE-VALUE-TYPE TLV-LENGTH
+ *                          MerkleLeafIndex
+ *                          Data
+ *                          MerkleProofHash*
+ *
+ * The root Data is named <prefix>/MERKLE/<root digest> and signed with a
+ * regular signature, so it is validated as any other packet.  Once a root
+ * is trusted, the packets of its batch only need their proof checked.
+ */
+class MerkleSignature
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  /// @brief SignatureType of batch signed packets
+  static const uint32_t SIGNATURE_TYPE;
+
+  static const name::Component ROOT_COMPONENT;
+
+  MerkleSignature(uint64_t index, const shared_ptr<const Data>& rootData,
+                  const std::vector<Digest>& proof);
+
+  /**
+   * @brief Decode the signature of @p data
+   *
+   * @throws Error if it is not a well formed batch signature
+   */
+  explicit
+  MerkleSignature(const Data& data);
+
+  /**
+   * @brief SignatureInfo that a packet must have before computing its leaf
+   */
+  static ndn::SignatureInfo
+  getSignatureInfo();
+
+  static bool
+  isMerkleSigned(const Data& data)
+  {
+    return data.getSignature().getType() == SIGNATURE_TYPE;
+  }
+
+  /**
+   * @brief Name of the root Data of a batch
+   */
+  static Name
+  getRootName(const Name& prefix, const Digest& root);
+
+  /**
+   * @brief The signature to set in the packet
+   */
+  ndn::Signature
+  getSignature() const;
+
+  const shared_ptr<const Data>&
+  getRootData() const
+  {
+    return m_rootData;
+  }
+
+  /**
+   * @brief Root digest of the batch, as named by the root Data
+   */
+  Digest
+  getRoot() const;
+
+  /**
+   * @brief Whether the proof of @p data leads to the root of the batch
+   */
+  bool
+  verifyProof(const Data& data) const;
+
+private:
+  uint64_t m_index;
+  shared_ptr<const Data> m_rootData;
+  std::vector<Digest> m_proof;
+};
+
+/**
+ * @brief Validation of batch signed packets with a cache of trusted roots
+ *
+ * Packets with a regular signature are passed to the validator.  For a
+ * batch signed packet the Merkle proof is checked, and its root Data is
+ * validated only if the root is not cached yet.  The last maxRoots roots
+ * validated are cached.
+ *
+ * The full names of the packets validated are kept in a ValidationCache, so
+ * a packet received again (from caches or retransmissions) is not validated
+ * again.
+ */
+class MerkleValidator : noncopyable
+{
+public:
+  static const size_t DEFAULT_MAX_ROOTS;
+
+  explicit
+  MerkleValidator(size_t maxRoots = DEFAULT_MAX_ROOTS,
+                  size_t maxValidatedNames = ValidationCache::DEFAULT_CAPACITY);
+
+  /**
+   * @brief Validate @p data
+   *
+   * If @p validator is NULL, packets are accepted as long as the proof of
+   * the batch signed ones is right.
+   */
+  void
+  validate(const Data& data,
+           const shared_ptr<ndn::Validator>& validator,
+           const ndn::OnDataValidated& onValidated,
+           const ndn::OnDataValidationFailed& onValidationFailed);
+
+private:
+  void
+  onDataValidated(const shared_ptr<const Data>& data,
+                  const ndn::OnDataValidated& onValidated);
+
+  void
+  onRootValidated(const shared_ptr<const Data>& data,
+                  const Digest& root,
+                  const ndn::OnDataValidated& onValidated);
+
+  void
+  onRootValidationFailed(const shared_ptr<const Data>& data,
+                         const std::string& failureInfo,
+                         const ndn::OnDataValidationFailed& onValidationFailed);
+
+  void
+  addRoot(const Digest& root);
+
+private:
+  size_t m_maxRoots;
+  std::set<Digest> m_roots;
+  // Cached roots, oldest first
+  std::deque<Digest> m_rootOrder;
+
+  ValidationCache m_validatedNames;
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_MERKLE_SIGNATURE_HPP
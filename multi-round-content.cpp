@@ -0,0 +1,134 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "tlv.hpp"
+
+#include "multi-round-content.hpp"
+
+namespace chronosync {
+
+MultiRoundContent::MultiRoundContent()
+  : m_nextRound(0)
+{
+}
+
+void
+MultiRoundContent::addRound(RoundNo roundNo, DataContentPtr dataContent)
+{
+  BOOST_ASSERT(m_rounds.empty() || m_rounds.back().first < roundNo);
+
+  m_rounds.push_back(std::make_pair(roundNo, dataContent));
+  m_wire.reset();
+}
+
+void
+MultiRoundContent::setNextRound(RoundNo roundNo)
+{
+  BOOST_ASSERT(m_rounds.empty() || m_rounds.back().first < roundNo);
+
+  m_nextRound = roundNo;
+  m_wire.reset();
+}
+
+template<bool T>
+size_t
+MultiRoundContent::wireEncode(ndn::EncodingImpl<T>& block) const
+{
+  size_t totalLength = 0;
+
+  if (m_nextRound != 0)
+    totalLength += prependNonNegativeIntegerBlock(block, tlv::NextRoundNo, m_nextRound);
+
+  BOOST_REVERSE_FOREACH (const RoundList::value_type& round, m_rounds)
+    {
+      totalLength += prependBlock(block, round.second->wireEncode());
+      totalLength += prependNonNegativeIntegerBlock(block, tlv::RoundNo, round.first);
+    }
+
+  totalLength += block.prependVarNumber(totalLength);
+  totalLength += block.prependVarNumber(tlv::MultiRoundContent);
+
+  return totalLength;
+}
+
+template size_t
+MultiRoundContent::wireEncode<true>(ndn::EncodingImpl<true>& block) const;
+
+template size_t
+MultiRoundContent::wireEncode<false>(ndn::EncodingImpl<false>& block) const;
+
+const Block&
+MultiRoundContent::wireEncode() const
+{
+  if (m_wire.hasWire())
+    return m_wire;
+
+  ndn::EncodingEstimator estimator;
+  size_t estimatedSize = wireEncode(estimator);
+
+  ndn::EncodingBuffer buffer(estimatedSize, 0);
+  wireEncode(buffer);
+
+  m_wire = buffer.block();
+  return m_wire;
+}
+
+void
+MultiRoundContent::wireDecode(const Block& wire)
+{
+  if (!wire.hasWire())
+    throw Error("The supplied block does not contain wire format");
+
+  if (wire.type() != tlv::MultiRoundContent)
+    throw Error("Unexpected TLV type when decoding MultiRoundContent: " +
+                boost::lexical_cast<std::string>(wire.type()));
+
+  m_wire = wire;
+  m_wire.parse();
+  m_rounds.clear();
+  m_nextRound = 0;
+
+  for (Block::element_const_iterator it = m_wire.elements_begin();
+       it != m_wire.elements_end(); it++) {
+    if (it->type() == tlv::NextRoundNo) {
+      m_nextRound = readNonNegativeInteger(*it);
+      if (++it != m_wire.elements_end())
+        throw Error("NextRoundNo must be the last element of MultiRoundContent");
+      break;
+    }
+
+    if (it->type() != tlv::RoundNo)
+      throw Error("Expecting RoundNo in MultiRoundContent");
+
+    RoundNo roundNo = readNonNegativeInteger(*it);
+    it++;
+
+    if (it == m_wire.elements_end())
+      throw Error("Missing DataContent of round " + boost::lexical_cast<std::string>(roundNo));
+
+    DataContentPtr dataContent = make_shared<DataContent>();
+    dataContent->wireDecode(*it);
+    m_rounds.push_back(std::make_pair(roundNo, dataContent));
+  }
+}
+
+} // namespace chronosync
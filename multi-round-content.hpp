@@ -0,0 +1,122 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_MULTI_ROUND_CONTENT_HPP
+#define CHRONOSYNC_MULTI_ROUND_CONTENT_HPP
+
+#include "data-content.hpp"
+
+namespace chronosync {
+
+/**
+ * @brief Content of the reply to a range Data Interest
+ *
+ * It carries, for each round of the range in which the producer has
+ * something, the DataContent it would have sent for a Data Interest of
+ * that round. A reply that doesn't cover the whole range, to fit in a
+ * Data packet, ends with the first round left out:
+ *
+ *     MultiRoundContent := MULTI-ROUND-CONTENT-TYPE TLV-LENGTH
+ *                            (RoundNo DataContent)*
+ *                            NextRoundNo?
+ */
+class MultiRoundContent
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  typedef std::vector<std::pair<RoundNo, DataContentPtr> > RoundList;
+
+  MultiRoundContent();
+
+  /**
+   * @brief Add the content of a round, rounds must be added in increasing order
+   */
+  void
+  addRound(RoundNo roundNo, DataContentPtr dataContent);
+
+  const RoundList&
+  getRounds() const
+  {
+    return m_rounds;
+  }
+
+  bool
+  empty() const
+  {
+    return m_rounds.empty();
+  }
+
+  /**
+   * @brief Mark the content as truncated before @p roundNo
+   *
+   * The rounds from @p roundNo to the end of the range must be asked again.
+   */
+  void
+  setNextRound(RoundNo roundNo);
+
+  /**
+   * @brief Get the first round left out of the content, 0 if none
+   */
+  RoundNo
+  getNextRound() const
+  {
+    return m_nextRound;
+  }
+
+  /**
+   * @brief Encode to a wire format
+   */
+  const Block&
+  wireEncode() const;
+
+  /**
+   * @brief Decode from the wire format
+   *
+   * @throws Error or DataContent::Error if the content is malformed
+   */
+  void
+  wireDecode(const Block& wire);
+
+protected:
+  mutable Block m_wire;
+
+  template<bool T>
+  size_t
+  wireEncode(ndn::EncodingImpl<T>& block) const;
+
+private:
+  RoundList m_rounds;
+  RoundNo m_nextRound;
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_MULTI_ROUND_CONTENT_HPP
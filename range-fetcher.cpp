@@ -0,0 +1,271 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "range-fetcher.hpp"
+#include "logger.hpp"
+
+INIT_LOGGER("RangeFetcher")
+
+namespace chronosync {
+
+shared_ptr<RangeFetcher>
+RangeFetcher::fetch(ndn::Face& face,
+                    RttEstimator& rttEstimator,
+                    MerkleValidator& merkleValidator,
+                    const shared_ptr<ndn::Validator>& validator,
+                    const Name& session, SeqNo low, SeqNo high,
+                    const ndn::OnDataValidated& onData,
+                    const FailureCallback& onFailure,
+                    const CompletionCallback& onCompletion,
+                    const Options& options)
+{
+  shared_ptr<RangeFetcher> fetcher(new RangeFetcher(face, rttEstimator, merkleValidator,
+                                                    validator, session, low, high,
+                                                    onData, onFailure, onCompletion,
+                                                    options));
+  if (fetcher->isComplete()) {
+    if (static_cast<bool>(onCompletion))
+      onCompletion(fetcher->m_stats);
+  }
+  else
+    fetcher->sendInterests();
+
+  return fetcher;
+}
+
+RangeFetcher::RangeFetcher(ndn::Face& face,
+                           RttEstimator& rttEstimator,
+                           MerkleValidator& merkleValidator,
+                           const shared_ptr<ndn::Validator>& validator,
+                           const Name& session, SeqNo low, SeqNo high,
+                           const ndn::OnDataValidated& onData,
+                           const FailureCallback& onFailure,
+                           const CompletionCallback& onCompletion,
+                           const Options& options)
+  : m_face(face)
+  , m_rttEstimator(rttEstimator)
+  , m_merkleValidator(merkleValidator)
+  , m_validator(validator)
+  , m_session(session)
+  , m_low(low)
+  , m_high(high)
+  , m_onData(onData)
+  , m_onFailure(onFailure)
+  , m_onCompletion(onCompletion)
+  , m_options(options)
+  , m_window(std::max(1.0, std::min(options.initialWindow, options.maxWindow)))
+  , m_nextSeq(low)
+  , m_nextDelivery(low)
+  , m_nItems(high >= low ? high - low + 1 : 0)
+  , m_nDone(0)
+  , m_isStopped(false)
+  , m_startTime(time::steady_clock::now())
+{
+}
+
+void
+RangeFetcher::stop()
+{
+  m_isStopped = true;
+
+  for (std::map<SeqNo, PendingInterest>::iterator it = m_pending.begin();
+       it != m_pending.end(); ++it)
+    m_face.removePendingInterest(it->second.id);
+  m_pending.clear();
+  m_retransmissions.clear();
+  m_reorderBuffer.clear();
+}
+
+RangeFetcher::Stats
+RangeFetcher::getStats() const
+{
+  Stats stats = m_stats;
+  if (!isComplete())
+    stats.duration = time::steady_clock::now() - m_startTime;
+  return stats;
+}
+
+void
+RangeFetcher::sendInterests()
+{
+  while (!m_isStopped && m_pending.size() < static_cast<size_t>(m_window)) {
+    if (!m_retransmissions.empty()) {
+      std::pair<SeqNo, unsigned> retransmission = m_retransmissions.front();
+      m_retransmissions.pop_front();
+      sendInterest(retransmission.first, retransmission.second);
+    }
+    else if (m_nextSeq - m_low < m_nItems)
+      sendInterest(m_nextSeq++, 1);
+    else
+      break;
+  }
+}
+
+void
+RangeFetcher::sendInterest(SeqNo seq, unsigned attempt)
+{
+  Name interestName;
+  interestName.append(m_session).appendNumber(seq);
+
+  Interest interest(interestName);
+  interest.setMustBeFresh(true);
+  interest.setInterestLifetime(m_rttEstimator.getRto(m_session, attempt));
+
+  if (attempt > 1)
+    m_stats.nRetransmissions++;
+
+  PendingInterest& pending = m_pending[seq];
+  pending.sentTime = time::steady_clock::now();
+  pending.attempt = attempt;
+  pending.id = m_face.expressInterest(interest,
+                                      bind(&RangeFetcher::onData, shared_from_this(),
+                                           _1, _2, seq),
+                                      bind(&RangeFetcher::onTimeout, shared_from_this(),
+                                           _1, seq));
+}
+
+void
+RangeFetcher::onData(const Interest& interest, Data& data, SeqNo seq)
+{
+  std::map<SeqNo, PendingInterest>::iterator it = m_pending.find(seq);
+  if (m_isStopped || it == m_pending.end())
+    return;
+
+  // RTT is measured by session name, only for first transmissions
+  if (it->second.attempt == 1)
+    m_rttEstimator.addMeasurement(m_session, time::steady_clock::now() - it->second.sentTime);
+  m_pending.erase(it);
+
+  // Additive increase: one more packet per window of Data
+  m_window = std::min(m_window + 1.0 / m_window, std::max(1.0, m_options.maxWindow));
+  m_stats.nBytes += data.wireEncode().size();
+
+  m_merkleValidator.validate(data, m_validator,
+                             bind(&RangeFetcher::onDataValidated, shared_from_this(), _1, seq),
+                             bind(&RangeFetcher::onDataValidationFailed, shared_from_this(),
+                                  _1, _2, seq));
+
+  sendInterests();
+}
+
+void
+RangeFetcher::onTimeout(const Interest& interest, SeqNo seq)
+{
+  std::map<SeqNo, PendingInterest>::iterator it = m_pending.find(seq);
+  if (m_isStopped || it == m_pending.end())
+    return;
+
+  PendingInterest pending = it->second;
+  m_pending.erase(it);
+  m_stats.nTimeouts++;
+
+  // Multiplicative decrease, once for the Interests in flight at the time
+  if (pending.sentTime >= m_lastDecrease) {
+    m_window = std::max(1.0, m_window / 2);
+    m_lastDecrease = time::steady_clock::now();
+    _LOG_DEBUG("RangeFetcher::onTimeout: " << interest.getName() << " window " << m_window);
+  }
+
+  if (pending.attempt > static_cast<unsigned>(std::max(m_options.maxRetries, 0)))
+    fail(seq, "Timeout");
+  else
+    m_retransmissions.push_back(std::make_pair(seq, pending.attempt + 1));
+
+  sendInterests();
+}
+
+void
+RangeFetcher::onDataValidated(const shared_ptr<const Data>& data, SeqNo seq)
+{
+  if (m_isStopped)
+    return;
+
+  m_stats.nReceived++;
+
+  if (m_options.isInOrder) {
+    m_reorderBuffer[seq] = data;
+    deliverInOrder();
+  }
+  else if (static_cast<bool>(m_onData))
+    m_onData(data);
+
+  finishItem();
+}
+
+void
+RangeFetcher::onDataValidationFailed(const shared_ptr<const Data>& data,
+                                     const std::string& failureInfo, SeqNo seq)
+{
+  if (m_isStopped)
+    return;
+
+  fail(seq, "Validation failed: " + failureInfo);
+}
+
+void
+RangeFetcher::fail(SeqNo seq, const std::string& reason)
+{
+  m_stats.nFailed++;
+
+  if (static_cast<bool>(m_onFailure))
+    m_onFailure(seq, reason);
+
+  if (m_options.isInOrder) {
+    m_reorderBuffer[seq] = shared_ptr<const Data>();
+    deliverInOrder();
+  }
+
+  finishItem();
+}
+
+void
+RangeFetcher::deliverInOrder()
+{
+  // The callback may stop the fetch, which clears the buffer
+  while (!m_isStopped && !m_reorderBuffer.empty() &&
+         m_reorderBuffer.begin()->first == m_nextDelivery) {
+    shared_ptr<const Data> data = m_reorderBuffer.begin()->second;
+    m_reorderBuffer.erase(m_reorderBuffer.begin());
+    m_nextDelivery++;
+
+    if (static_cast<bool>(data) && static_cast<bool>(m_onData))
+      m_onData(data);
+  }
+}
+
+void
+RangeFetcher::finishItem()
+{
+  m_nDone++;
+  if (!isComplete() || m_isStopped)
+    return;
+
+  m_stats.duration = time::steady_clock::now() - m_startTime;
+  _LOG_DEBUG("RangeFetcher: " << m_session << " [" << m_low << ", " << m_high << "] in "
+             << m_stats.duration.count() / 1000000 << " ms, "
+             << m_stats.getThroughput() << " B/s");
+
+  if (static_cast<bool>(m_onCompletion))
+    m_onCompletion(m_stats);
+}
+
+} // namespace chronosync
@@ -0,0 +1,248 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_RANGE_FETCHER_HPP
+#define CHRONOSYNC_RANGE_FETCHER_HPP
+
+#include "leaf.hpp"
+#include "merkle-signature.hpp"
+#include "rtt-estimator.hpp"
+
+#include <deque>
+#include <map>
+
+#include <ndn-cxx/face.hpp>
+
+namespace chronosync {
+
+/**
+ * @brief Fetch of the packets of a range of seqNos of a session
+ *
+ * Interests are pipelined with an AIMD congestion window: the window grows
+ * by one packet per window of Data received, and is halved on a timeout
+ * (at most once per window of Interests).  Interest lifetimes come from the
+ * RttEstimator, doubled for each retransmission of an item.
+ *
+ * Packets are validated as in Socket::fetchData() and delivered as they
+ * arrive, or in seqNo order if Options::isInOrder.  An item is failed when
+ * its retries are exhausted or its validation fails; the fetch is complete
+ * when every item was delivered or failed.
+ *
+ * A RangeFetcher is created with fetch() and owned by its pending callbacks,
+ * so it lives until the fetch is complete or stopped.
+ */
+class RangeFetcher : noncopyable, public enable_shared_from_this<RangeFetcher>
+{
+public:
+  struct Options
+  {
+    Options()
+      : initialWindow(4)
+      , maxWindow(256)
+      , maxRetries(3)
+      , isInOrder(false)
+    {
+    }
+
+    /// Interests in flight at the start
+    double initialWindow;
+    /// upper bound of the window
+    double maxWindow;
+    /// retransmissions of each item
+    int maxRetries;
+    /// deliver the packets in seqNo order (failed items are skipped)
+    bool isInOrder;
+  };
+
+  /**
+   * @brief Aggregate counters of a fetch
+   */
+  struct Stats
+  {
+    Stats()
+      : nReceived(0)
+      , nFailed(0)
+      , nRetransmissions(0)
+      , nTimeouts(0)
+      , nBytes(0)
+      , duration(0)
+    {
+    }
+
+    /// @brief Bytes of the received packets per second
+    double
+    getThroughput() const
+    {
+      double seconds = duration.count() / 1e9;
+      return seconds > 0 ? nBytes / seconds : 0;
+    }
+
+    /// @brief Received packets per second
+    double
+    getPacketRate() const
+    {
+      double seconds = duration.count() / 1e9;
+      return seconds > 0 ? nReceived / seconds : 0;
+    }
+
+    size_t nReceived;
+    size_t nFailed;
+    size_t nRetransmissions;
+    size_t nTimeouts;
+    /// wire size of the received packets
+    size_t nBytes;
+    /// since the fetch started, until it was complete
+    time::nanoseconds duration;
+  };
+
+  typedef function<void(SeqNo seq, const std::string& reason)> FailureCallback;
+  typedef function<void(const Stats& stats)> CompletionCallback;
+
+  /**
+   * @brief Start fetching @p session from @p low to @p high (both included)
+   *
+   * @param onData       called with each validated packet
+   * @param onFailure    called for each failed item
+   * @param onCompletion called once, when all the items are done
+   */
+  static shared_ptr<RangeFetcher>
+  fetch(ndn::Face& face,
+        RttEstimator& rttEstimator,
+        MerkleValidator& merkleValidator,
+        const shared_ptr<ndn::Validator>& validator,
+        const Name& session, SeqNo low, SeqNo high,
+        const ndn::OnDataValidated& onData,
+        const FailureCallback& onFailure,
+        const CompletionCallback& onCompletion,
+        const Options& options = Options());
+
+  /**
+   * @brief Stop the fetch, without calling any more callbacks
+   */
+  void
+  stop();
+
+  /**
+   * @brief Counters so far; duration is the time since the start if not complete
+   */
+  Stats
+  getStats() const;
+
+  double
+  getWindow() const
+  {
+    return m_window;
+  }
+
+  bool
+  isComplete() const
+  {
+    return m_nDone == m_nItems;
+  }
+
+private:
+  RangeFetcher(ndn::Face& face,
+               RttEstimator& rttEstimator,
+               MerkleValidator& merkleValidator,
+               const shared_ptr<ndn::Validator>& validator,
+               const Name& session, SeqNo low, SeqNo high,
+               const ndn::OnDataValidated& onData,
+               const FailureCallback& onFailure,
+               const CompletionCallback& onCompletion,
+               const Options& options);
+
+  /// @brief Send Interests while the window is not full
+  void
+  sendInterests();
+
+  void
+  sendInterest(SeqNo seq, unsigned attempt);
+
+  void
+  onData(const Interest& interest, Data& data, SeqNo seq);
+
+  void
+  onTimeout(const Interest& interest, SeqNo seq);
+
+  void
+  onDataValidated(const shared_ptr<const Data>& data, SeqNo seq);
+
+  void
+  onDataValidationFailed(const shared_ptr<const Data>& data,
+                         const std::string& failureInfo, SeqNo seq);
+
+  void
+  fail(SeqNo seq, const std::string& reason);
+
+  /// @brief Deliver the buffered packets that are next in order
+  void
+  deliverInOrder();
+
+  /// @brief Count an item as done, completing the fetch after the last one
+  void
+  finishItem();
+
+private:
+  struct PendingInterest
+  {
+    const ndn::PendingInterestId* id;
+    time::steady_clock::time_point sentTime;
+    unsigned attempt;
+  };
+
+  ndn::Face& m_face;
+  RttEstimator& m_rttEstimator;
+  MerkleValidator& m_merkleValidator;
+  shared_ptr<ndn::Validator> m_validator;
+
+  Name m_session;
+  SeqNo m_low;
+  SeqNo m_high;
+  ndn::OnDataValidated m_onData;
+  FailureCallback m_onFailure;
+  CompletionCallback m_onCompletion;
+  Options m_options;
+
+  double m_window;
+  // Interests sent before this time don't decrease the window again
+  time::steady_clock::time_point m_lastDecrease;
+
+  // Next seqNo never requested
+  SeqNo m_nextSeq;
+  std::map<SeqNo, PendingInterest> m_pending;
+  // Items waiting to be requested again, with their next attempt
+  std::deque<std::pair<SeqNo, unsigned> > m_retransmissions;
+
+  // Validated packets (NULL for failed items) not delivered yet, if in order
+  std::map<SeqNo, shared_ptr<const Data> > m_reorderBuffer;
+  SeqNo m_nextDelivery;
+
+  SeqNo m_nItems;
+  SeqNo m_nDone;
+  bool m_isStopped;
+  time::steady_clock::time_point m_startTime;
+  Stats m_stats;
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_RANGE_FETCHER_HPP
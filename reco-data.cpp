@@ -28,11 +28,17 @@
 namespace chronosync {
 
 RecoData::RecoData()
+  :m_roundNo (0)
+  ,m_baseRoundNo (0)
+  ,m_transferId (0)
 {
 }
 
-RecoData::RecoData(RoundNo roundNo, DiffStatePtr statePtr)
+RecoData::RecoData(RoundNo roundNo, DiffStatePtr statePtr, RoundNo baseRoundNo,
+                   uint64_t transferId)
   :m_roundNo (roundNo)
+  ,m_baseRoundNo (baseRoundNo)
+  ,m_transferId (transferId)
   ,m_statePtr (statePtr)
 {
 }
@@ -54,6 +60,14 @@ RecoData::wireEncode(ndn::EncodingImpl<T>& block) const
   }
 
 
+  // encode transfer id of the next segments
+  if (m_transferId != 0)
+    totalLength += prependNonNegativeIntegerBlock(block, tlv::RecoTransferId, m_transferId);
+
+  // encode base roundNo of a delta
+  if (m_baseRoundNo != 0)
+    totalLength += prependNonNegativeIntegerBlock(block, tlv::BaseRoundNo, m_baseRoundNo);
+
   // encode roundNo
   totalLength += prependNonNegativeIntegerBlock(block, tlv::RoundNo, m_roundNo);
   
@@ -114,6 +128,20 @@ RecoData::wireDecode(const Block& wire)
   m_roundNo = readNonNegativeInteger(*it);
   it++;
 
+  // Decode base roundNo, if it exists
+  m_baseRoundNo = 0;
+  if (it != m_wire.elements_end() && it->type() == tlv::BaseRoundNo) {
+    m_baseRoundNo = readNonNegativeInteger(*it);
+    it++;
+  }
+
+  // Decode transfer id, if it exists
+  m_transferId = 0;
+  if (it != m_wire.elements_end() && it->type() == tlv::RecoTransferId) {
+    m_transferId = readNonNegativeInteger(*it);
+    it++;
+  }
+
   // Decode state
   m_statePtr = make_shared<DiffState>();
   m_statePtr->wireDecode(*it);
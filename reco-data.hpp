@@ -47,8 +47,18 @@ public:
 
   RecoData();
 
+  /**
+   * @param roundNo   Round of the state
+   * @param statePtr  Full state, or changes since baseRoundNo
+   * @param baseRoundNo If not 0, statePtr only contains the changes after
+   *                  this round (delta recovery)
+   * @param transferId If not 0, the id under which the other segments of
+   *                  the Reco Data are requested (first segment only)
+   */
   RecoData(RoundNo roundNo,
-	   DiffStatePtr statePtr);
+	   DiffStatePtr statePtr,
+	   RoundNo baseRoundNo = 0,
+	   uint64_t transferId = 0);
 
   StatePtr 
   getState(){
@@ -60,6 +70,22 @@ getRoundNo(){
   return m_roundNo;
 }
 
+/**
+ * @brief Round after which the state contains the changes, 0 for a full state
+ */
+RoundNo
+getBaseRoundNo(){
+  return m_baseRoundNo;
+}
+
+/**
+ * @brief Id of the transfer of the next segments, 0 if none
+ */
+uint64_t
+getTransferId(){
+  return m_transferId;
+}
+
   /**
    * @brief Encode to a wire format
    */
@@ -95,6 +121,8 @@ protected:
 
 private:
   RoundNo m_roundNo; // The round of m_statePtr
+  RoundNo m_baseRoundNo; // m_statePtr has the changes after this round, 0 if full
+  uint64_t m_transferId; // Id to request the next segments, 0 if none
   DiffStatePtr m_statePtr;
   tlv::DataType m_dataType;
 };
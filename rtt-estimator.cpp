@@ -0,0 +1,88 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "rtt-estimator.hpp"
+
+namespace chronosync {
+
+// Lower bound of the RTO, so that a few fast replies don't make us
+// retransmit on any delay
+const time::milliseconds RttEstimator::DEFAULT_MIN_RTO(20);
+
+// Upper bound of the RTO, also with backoff
+const time::milliseconds RttEstimator::DEFAULT_MAX_RTO(4000);
+
+RttEstimator::RttEstimator(const time::milliseconds& initialRto,
+                           const time::milliseconds& minRto,
+                           const time::milliseconds& maxRto)
+  : m_initialRto(initialRto)
+  , m_minRto(minRto)
+  , m_maxRto(std::max(minRto, maxRto))
+{
+}
+
+void
+RttEstimator::addMeasurement(const Name& prefix, const time::nanoseconds& rtt)
+{
+  Estimate& estimate = m_estimates[prefix];
+
+  if (estimate.nSamples == 0) {
+    estimate.srtt = rtt;
+    estimate.rttVar = rtt / 2;
+  }
+  else {
+    // RTTVAR is updated with the previous SRTT
+    time::nanoseconds error = estimate.srtt > rtt ? estimate.srtt - rtt : rtt - estimate.srtt;
+    estimate.rttVar = (estimate.rttVar * 3 + error) / 4;
+    estimate.srtt = (estimate.srtt * 7 + rtt) / 8;
+  }
+  estimate.nSamples++;
+
+  time::milliseconds rto =
+    time::duration_cast<time::milliseconds>(estimate.srtt + estimate.rttVar * 4);
+  estimate.rto = std::min(std::max(rto, m_minRto), m_maxRto);
+}
+
+time::milliseconds
+RttEstimator::getRto(const Name& prefix, unsigned retries) const
+{
+  std::map<Name, Estimate>::const_iterator it = m_estimates.find(prefix);
+  time::milliseconds rto = it != m_estimates.end() ? it->second.rto : m_initialRto;
+
+  for (unsigned i = 1; i < retries && rto < m_maxRto; ++i)
+    rto = rto * 2;
+
+  return std::min(rto, std::max(m_initialRto, m_maxRto));
+}
+
+bool
+RttEstimator::getEstimate(const Name& prefix, Estimate& estimate) const
+{
+  std::map<Name, Estimate>::const_iterator it = m_estimates.find(prefix);
+  if (it == m_estimates.end())
+    return false;
+
+  estimate = it->second;
+  return true;
+}
+
+} // namespace chronosync
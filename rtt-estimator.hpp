@@ -0,0 +1,112 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_RTT_ESTIMATOR_HPP
+#define CHRONOSYNC_RTT_ESTIMATOR_HPP
+
+#include "common-chronosync.hpp"
+
+#include <map>
+
+namespace chronosync {
+
+/**
+ * @brief Round trip time estimation per prefix
+ *
+ * For each prefix the smoothed RTT (SRTT), the RTT variation (RTTVAR) and
+ * the retransmission timeout (RTO) are computed as in RFC 6298.  Prefixes
+ * without measurements use the initial RTO.
+ *
+ * Only Interests answered at their first transmission must be measured
+ * (Karn's algorithm), and only when the Data already exists, so that the
+ * time the producer takes to produce it is not taken as RTT.
+ */
+class RttEstimator
+{
+public:
+  struct Estimate
+  {
+    Estimate()
+      : srtt(0)
+      , rttVar(0)
+      , rto(0)
+      , nSamples(0)
+    {
+    }
+
+    time::nanoseconds srtt;
+    time::nanoseconds rttVar;
+    time::milliseconds rto;
+    size_t nSamples;
+  };
+
+  static const time::milliseconds DEFAULT_MIN_RTO;
+  static const time::milliseconds DEFAULT_MAX_RTO;
+
+  explicit
+  RttEstimator(const time::milliseconds& initialRto,
+               const time::milliseconds& minRto = DEFAULT_MIN_RTO,
+               const time::milliseconds& maxRto = DEFAULT_MAX_RTO);
+
+  /**
+   * @brief Add a RTT measurement for @p prefix
+   */
+  void
+  addMeasurement(const Name& prefix, const time::nanoseconds& rtt);
+
+  /**
+   * @brief RTO for the @p retries transmission of an Interest to @p prefix
+   *
+   * The RTO is doubled for each retransmission (exponential backoff), up
+   * to the maximum RTO.
+   */
+  time::milliseconds
+  getRto(const Name& prefix, unsigned retries = 1) const;
+
+  /**
+   * @brief Get the current estimate for @p prefix
+   *
+   * @return false if there are no measurements for @p prefix
+   */
+  bool
+  getEstimate(const Name& prefix, Estimate& estimate) const;
+
+  /**
+   * @brief Current estimates of all the measured prefixes
+   */
+  const std::map<Name, Estimate>&
+  getEstimates() const
+  {
+    return m_estimates;
+  }
+
+private:
+  time::milliseconds m_initialRto;
+  time::milliseconds m_minRto;
+  time::milliseconds m_maxRto;
+
+  std::map<Name, Estimate> m_estimates;
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_RTT_ESTIMATOR_HPP
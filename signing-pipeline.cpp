@@ -0,0 +1,113 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "signing-pipeline.hpp"
+#include "logger.hpp"
+
+INIT_LOGGER("SigningPipeline")
+
+namespace chronosync {
+
+// Packets waiting to be signed before sign() starts signing synchronously
+const size_t SigningPipeline::DEFAULT_MAX_QUEUE_SIZE(256);
+
+// Packets signed in each scheduler event
+const size_t SigningPipeline::DEFAULT_BATCH_SIZE(8);
+
+SigningPipeline::SigningPipeline(ndn::Scheduler& scheduler,
+                                 ndn::KeyChain& keyChain,
+                                 size_t maxQueueSize,
+                                 size_t batchSize)
+  : m_scheduler(scheduler)
+  , m_keyChain(keyChain)
+  , m_maxQueueSize(std::max<size_t>(maxQueueSize, 1))
+  , m_batchSize(std::max<size_t>(batchSize, 1))
+  , m_isBatchScheduled(false)
+{
+}
+
+SigningPipeline::~SigningPipeline()
+{
+  m_scheduler.cancelEvent(m_batchId);
+}
+
+void
+SigningPipeline::sign(const shared_ptr<Data>& data, const Name& signingId,
+                      const SignedCallback& onSigned)
+{
+  // Backpressure: make room by signing the oldest packets now
+  while (m_queue.size() >= m_maxQueueSize) {
+    _LOG_DEBUG("Signing queue full, signing " << m_queue.front().data->getName());
+    signNext();
+  }
+
+  Entry entry;
+  entry.data = data;
+  entry.signingId = signingId;
+  entry.onSigned = onSigned;
+  m_queue.push_back(entry);
+
+  if (!m_isBatchScheduled) {
+    m_isBatchScheduled = true;
+    m_batchId = m_scheduler.scheduleEvent(time::seconds(0),
+                                          bind(&SigningPipeline::signBatch, this));
+  }
+}
+
+void
+SigningPipeline::flush()
+{
+  while (!m_queue.empty())
+    signNext();
+}
+
+void
+SigningPipeline::signNext()
+{
+  // The entry is removed before calling back, which may queue more packets
+  Entry entry = m_queue.front();
+  m_queue.pop_front();
+
+  if (entry.signingId.empty())
+    m_keyChain.sign(*entry.data);
+  else
+    m_keyChain.signByIdentity(*entry.data, entry.signingId);
+
+  entry.onSigned(entry.data);
+}
+
+void
+SigningPipeline::signBatch()
+{
+  m_isBatchScheduled = false;
+
+  for (size_t i = 0; i < m_batchSize && !m_queue.empty(); ++i)
+    signNext();
+
+  if (!m_queue.empty() && !m_isBatchScheduled) {
+    m_isBatchScheduled = true;
+    m_batchId = m_scheduler.scheduleEvent(time::seconds(0),
+                                          bind(&SigningPipeline::signBatch, this));
+  }
+}
+
+} // namespace chronosync
@@ -0,0 +1,116 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_SIGNING_PIPELINE_HPP
+#define CHRONOSYNC_SIGNING_PIPELINE_HPP
+
+#include "common-chronosync.hpp"
+
+#include <deque>
+
+#include <ndn-cxx/util/scheduler.hpp>
+#include <ndn-cxx/security/key-chain.hpp>
+
+namespace chronosync {
+
+/**
+ * @brief Deferred signing of Data packets
+ *
+ * Packets handed to sign() are queued and signed later, in batches of at
+ * most the batch size per scheduler event, so that the Interests and Data
+ * received in between are processed without waiting for all the pending
+ * signatures.  When a packet is signed its callback is called, which
+ * usually puts it in the face or in a storage.
+ *
+ * Packets are signed, and their callbacks called, in the order in which
+ * they were queued.  When the queue is full, sign() first signs the oldest
+ * packets, so producers are slowed down to the signing rate.
+ */
+class SigningPipeline : noncopyable
+{
+public:
+  typedef function<void(const shared_ptr<Data>& data)> SignedCallback;
+
+  static const size_t DEFAULT_MAX_QUEUE_SIZE;
+  static const size_t DEFAULT_BATCH_SIZE;
+
+  SigningPipeline(ndn::Scheduler& scheduler,
+                  ndn::KeyChain& keyChain,
+                  size_t maxQueueSize = DEFAULT_MAX_QUEUE_SIZE,
+                  size_t batchSize = DEFAULT_BATCH_SIZE);
+
+  ~SigningPipeline();
+
+  /**
+   * @brief Queue @p data to be signed
+   *
+   * @param data      the packet, whose name and content must be set
+   * @param signingId identity to sign with, the default one if empty
+   * @param onSigned  called with @p data once it is signed
+   */
+  void
+  sign(const shared_ptr<Data>& data, const Name& signingId, const SignedCallback& onSigned);
+
+  /**
+   * @brief Sign all the queued packets now
+   */
+  void
+  flush();
+
+  /**
+   * @brief Number of packets waiting to be signed
+   */
+  size_t
+  size() const
+  {
+    return m_queue.size();
+  }
+
+private:
+  void
+  signNext();
+
+  void
+  signBatch();
+
+private:
+  struct Entry
+  {
+    shared_ptr<Data> data;
+    Name signingId;
+    SignedCallback onSigned;
+  };
+
+  ndn::Scheduler& m_scheduler;
+  ndn::KeyChain& m_keyChain;
+
+  size_t m_maxQueueSize;
+  size_t m_batchSize;
+
+  std::deque<Entry> m_queue;
+  bool m_isBatchScheduled;
+  ndn::EventId m_batchId;
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_SIGNING_PIPELINE_HPP
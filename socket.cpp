@@ -33,6 +33,7 @@ namespace chronosync {
 const ndn::Name Socket::DEFAULT_NAME;
 const ndn::Name Socket::DEFAULT_PREFIX;
 const ndn::shared_ptr<ndn::Validator> Socket::DEFAULT_VALIDATOR;
+const size_t Socket::DEFAULT_MAX_BATCH_SIZE(256);
 
 Socket::Socket(const Name& syncPrefix,
                const Name& userPrefix,
@@ -44,8 +45,11 @@ Socket::Socket(const Name& syncPrefix,
   , m_face(face)
   , m_logic(face, syncPrefix, userPrefix, updateCallback)
   , m_signingId(signingId)
-  , m_keyChain(ns3::ndn::StackHelper::getKeyChain())
   , m_validator(validator)
+  , m_store(make_shared<MemoryDataStore>())
+  , m_isBatchSigning(false)
+  , m_maxBatchSize(DEFAULT_MAX_BATCH_SIZE)
+  , m_scheduler(m_face.getIoService())
 {
   m_registeredPrefixList[m_userPrefix] =
     m_face.setInterestFilter(m_userPrefix,
@@ -59,7 +63,14 @@ Socket::~Socket()
     if (static_cast<bool>(itr.second))
       m_face.unsetInterestFilter(itr.second);
   }
-  m_ims.erase("/");
+  // The packets stay in m_store, which may be kept (e.g., a DiskDataStore)
+
+  BOOST_FOREACH (const weak_ptr<RangeFetcher>& fetcher, m_fetchers)
+    {
+      shared_ptr<RangeFetcher> running = fetcher.lock();
+      if (static_cast<bool>(running))
+        running->stop();
+    }
 }
 
 
@@ -78,19 +89,143 @@ Socket::publishData(const Block& content, const ndn::time::milliseconds& freshne
   data->setContent(content);
   data->setFreshnessPeriod(freshness);
 
+  nameData(*data, prefix);
+  signData(data, prefix, true);
+}
+
+void
+Socket::publishBatch(const std::vector<Block>& contents,
+                     const ndn::time::milliseconds& freshness,
+                     const Name& prefix)
+{
+  _LOG_DEBUG("Socket::publishBatch: " << contents.size() << " packets");
+
+  // Packets are signed in order, so when the last one is signed all the
+  // others are already stored and its seqNo can be announced
+  for (size_t i = 0; i < contents.size(); ++i) {
+    shared_ptr<Data> data = make_shared<Data>();
+    data->setContent(contents[i]);
+    data->setFreshnessPeriod(freshness);
+
+    nameData(*data, prefix);
+    signData(data, prefix, i + 1 == contents.size());
+  }
+}
+
+SeqNo
+Socket::nameData(Data& data, const Name& prefix)
+{
+  const Name& sessionName = m_logic.getSessionName(prefix);
+
+  // Data waiting to be signed already took the next seqNos
   SeqNo newSeq = m_logic.getSeqNo(prefix) + 1;
+  std::map<Name, SeqNo>::const_iterator pending = m_pendingSeqNo.find(sessionName);
+  if (pending != m_pendingSeqNo.end())
+    newSeq = std::max(newSeq, pending->second + 1);
+
   Name dataName;
-  dataName.append(m_logic.getSessionName(prefix)).appendNumber(newSeq);
-  data->setName(dataName);
+  dataName.append(sessionName).appendNumber(newSeq);
+  data.setName(dataName);
+
+  // The new seqNo is announced once the Data is signed and can be served
+  m_pendingSeqNo[sessionName] = newSeq;
 
-  if (m_signingId.empty())
-    m_keyChain.sign(*data);
+  return newSeq;
+}
+
+void
+Socket::signData(const shared_ptr<Data>& data, const Name& prefix, bool isAnnounced)
+{
+  if (m_isBatchSigning) {
+    BatchEntry entry = { data, prefix, isAnnounced };
+    m_batch.push_back(entry);
+    if (m_batch.size() >= m_maxBatchSize) {
+      m_scheduler.cancelEvent(m_batchId);
+      signBatch();
+    }
+    else if (m_batch.size() == 1)
+      m_batchId = m_scheduler.scheduleEvent(m_batchWindow, bind(&Socket::signBatch, this));
+  }
   else
-    m_keyChain.signByIdentity(*data, m_signingId);
+    m_logic.getSigningPipeline().sign(data, m_signingId,
+                                      bind(&Socket::onDataSigned, this, _1, prefix,
+                                           isAnnounced));
+}
+
+void
+Socket::setDataStore(const shared_ptr<DataStore>& store)
+{
+  BOOST_ASSERT(static_cast<bool>(store));
+  m_store = store;
+}
+
+void
+Socket::enableBatchSigning(const ndn::time::milliseconds& window, size_t maxBatchSize)
+{
+  m_isBatchSigning = true;
+  m_batchWindow = window;
+  m_maxBatchSize = std::max<size_t>(maxBatchSize, 1);
+}
+
+void
+Socket::signBatch()
+{
+  if (m_batch.empty())
+    return;
+
+  _LOG_DEBUG("Socket::signBatch: " << m_batch.size() << " packets");
+
+  // The root is named under the longest prefix of all the packets, which
+  // is all its signer can vouch for
+  Name prefix = m_batch.front().data->getName();
+  std::vector<Digest> leaves;
+  leaves.reserve(m_batch.size());
+  for (size_t i = 0; i < m_batch.size(); ++i) {
+    Data& data = *m_batch[i].data;
+    while (!prefix.isPrefixOf(data.getName()))
+      prefix = prefix.getPrefix(-1);
+
+    data.setSignature(ndn::Signature(MerkleSignature::getSignatureInfo()));
+    leaves.push_back(MerkleTree::computeLeaf(data));
+  }
+
+  shared_ptr<MerkleTree> tree = make_shared<MerkleTree>(leaves);
+  shared_ptr<Data> rootData =
+    make_shared<Data>(MerkleSignature::getRootName(prefix, tree->getRoot()));
 
-  m_ims.insert(*data);
+  std::vector<BatchEntry> batch;
+  batch.swap(m_batch);
 
-  m_logic.updateSeqNo(newSeq, prefix);
+  m_logic.getSigningPipeline().sign(rootData, m_signingId,
+                                    bind(&Socket::onBatchSigned, this, _1, batch, tree));
+}
+
+void
+Socket::onBatchSigned(const shared_ptr<Data>& rootData,
+                      const std::vector<BatchEntry>& batch,
+                      const shared_ptr<MerkleTree>& tree)
+{
+  for (size_t i = 0; i < batch.size(); ++i) {
+    MerkleSignature signature(i, rootData, tree->getProof(i));
+    batch[i].data->setSignature(signature.getSignature());
+    onDataSigned(batch[i].data, batch[i].prefix, batch[i].isAnnounced);
+  }
+}
+
+void
+Socket::onDataSigned(const shared_ptr<Data>& data, const Name& prefix, bool isAnnounced)
+{
+  m_store->insert(*data);
+
+  SeqNo seq = data->getName().get(-1).toNumber();
+  Name sessionName = data->getName().getPrefix(-1);
+  std::map<Name, SeqNo>::iterator pending = m_pendingSeqNo.find(sessionName);
+  if (pending != m_pendingSeqNo.end() && pending->second == seq)
+    m_pendingSeqNo.erase(pending);
+
+  // The session may have been reset while the Data was being signed
+  if (isAnnounced && sessionName == m_logic.getSessionName(prefix))
+    m_logic.updateSeqNo(seq, prefix);
 }
 
 void
@@ -103,13 +238,15 @@ Socket::fetchData(const Name& sessionName, const SeqNo& seqNo,
 
   Interest interest(interestName);
   interest.setMustBeFresh(true);
+  interest.setInterestLifetime(m_logic.getRttEstimator().getRto(sessionName));
 
   ndn::OnDataValidationFailed failureCallback =
     bind(&Socket::onDataValidationFailed, this, _1, _2);
 
   m_face.expressInterest(interest,
-                         bind(&Socket::onData, this, _1, _2, dataCallback, failureCallback),
-                         bind(&Socket::onDataTimeout, this, _1, nRetries,
+                         bind(&Socket::onData, this, _1, _2, time::steady_clock::now(),
+                              dataCallback, failureCallback),
+                         bind(&Socket::onDataTimeout, this, _1, nRetries, 1,
                               dataCallback, failureCallback));
 }
 
@@ -124,20 +261,49 @@ Socket::fetchData(const Name& sessionName, const SeqNo& seqNo,
   Name interestName;
   interestName.append(sessionName).appendNumber(seqNo);
 
+  // The Interest is not retransmitted before onTimeout is called, so it
+  // keeps the default lifetime: an RTO would time out on ordinary jitter
   Interest interest(interestName);
   interest.setMustBeFresh(true);
 
   m_face.expressInterest(interest,
-                         bind(&Socket::onData, this, _1, _2, dataCallback, failureCallback),
+                         bind(&Socket::onData, this, _1, _2, time::steady_clock::now(),
+                              dataCallback, failureCallback),
                          onTimeout);
 
   _LOG_DEBUG("<< Socket::fetchData");
 }
 
+shared_ptr<RangeFetcher>
+Socket::fetchRange(const Name& sessionName, const SeqNo& low, const SeqNo& high,
+                   const ndn::OnDataValidated& onValidated,
+                   const RangeFetcher::FailureCallback& onFailure,
+                   const RangeFetcher::CompletionCallback& onCompletion,
+                   const RangeFetcher::Options& options)
+{
+  _LOG_DEBUG("Socket::fetchRange: " << sessionName << " [" << low << ", " << high << "]");
+
+  // Forget the fetches that are over
+  std::list<weak_ptr<RangeFetcher> >::iterator it = m_fetchers.begin();
+  while (it != m_fetchers.end()) {
+    if (it->expired())
+      it = m_fetchers.erase(it);
+    else
+      ++it;
+  }
+
+  shared_ptr<RangeFetcher> fetcher =
+    RangeFetcher::fetch(m_face, m_logic.getRttEstimator(), m_logic.getMerkleValidator(),
+                        m_validator, sessionName, low, high,
+                        onValidated, onFailure, onCompletion, options);
+  m_fetchers.push_back(fetcher);
+  return fetcher;
+}
+
 void
 Socket::onInterest(const Name& prefix, const Interest& interest)
 {
-  shared_ptr<const Data>data = m_ims.find(interest);
+  shared_ptr<const Data>data = m_store->find(interest);
   if (static_cast<bool>(data)) {
     m_face.put(*data);
   }
@@ -145,19 +311,22 @@ Socket::onInterest(const Name& prefix, const Interest& interest)
 
 void
 Socket::onData(const Interest& interest, Data& data,
+               const time::steady_clock::time_point& sentTime,
                const ndn::OnDataValidated& onValidated,
                const ndn::OnDataValidationFailed& onFailed)
 {
   _LOG_DEBUG("Socket::onData");
 
-  if (static_cast<bool>(m_validator))
-    m_validator->validate(data, onValidated, onFailed);
-  else
-    onValidated(data.shared_from_this());
+  // RTT is measured by session name, only for first transmissions
+  if (sentTime != time::steady_clock::time_point())
+    m_logic.getRttEstimator().addMeasurement(interest.getName().getPrefix(-1),
+                                             time::steady_clock::now() - sentTime);
+
+  m_logic.getMerkleValidator().validate(data, m_validator, onValidated, onFailed);
 }
 
 void
-Socket::onDataTimeout(const Interest& interest, int nRetries,
+Socket::onDataTimeout(const Interest& interest, int nRetries, unsigned attempt,
                       const ndn::OnDataValidated& onValidated,
                       const ndn::OnDataValidationFailed& onFailed)
 {
@@ -165,9 +334,16 @@ Socket::onDataTimeout(const Interest& interest, int nRetries,
   if (nRetries <= 0)
     return;
 
-  m_face.expressInterest(interest,
-                         bind(&Socket::onData, this, _1, _2, onValidated, onFailed),
-                         bind(&Socket::onDataTimeout, this, _1, nRetries - 1,
+  // Back off: each retransmission waits twice as long for the Data
+  Interest retry(interest);
+  retry.refreshNonce();
+  retry.setInterestLifetime(m_logic.getRttEstimator().getRto(interest.getName().getPrefix(-1),
+                                                             attempt + 1));
+
+  m_face.expressInterest(retry,
+                         bind(&Socket::onData, this, _1, _2, time::steady_clock::time_point(),
+                              onValidated, onFailed),
+                         bind(&Socket::onDataTimeout, this, _1, nRetries - 1, attempt + 1,
                               onValidated, onFailed));
 }
 
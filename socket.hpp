@@ -26,10 +26,11 @@
 #define CHRONOSYNC_SOCKET_HPP
 
 #include <ndn-cxx/face.hpp>
-#include <ndn-cxx/util/in-memory-storage-persistent.hpp>
 #include <unordered_map>
 
 #include "logic.hpp"
+#include "data-store.hpp"
+#include "range-fetcher.hpp"
 
 #include "ns3/ndnSIM-module.h"
 
@@ -77,6 +78,8 @@ public:
    * This method will create a data packet with the supplied content.
    * The packet name is the local session + seqNo.
    * The seqNo is automatically maintained by internal Logic.
+   * The packet is signed by the signing pipeline of the Logic, and the new
+   * seqNo is announced once it is signed.
    *
    * @throws It will throw error, if the prefix does not exist in m_logic
    *
@@ -94,6 +97,8 @@ public:
    * This method will create a data packet with the supplied content.
    * The packet name is the local session + seqNo.
    * The seqNo is automatically maintained by internal Logic.
+   * The packet is signed by the signing pipeline of the Logic, and the new
+   * seqNo is announced once it is signed.
    *
    * @throws It will throw error, if the prefix does not exist in m_logic
    *
@@ -104,6 +109,36 @@ public:
   publishData(const Block& content, const ndn::time::milliseconds& freshness,
               const Name& prefix = DEFAULT_PREFIX);
 
+  /**
+   * @brief Publish several data packets in the session at once
+   *
+   * The packets take consecutive seqNos, in the order of @p contents.  They
+   * are signed as publishData() does (in the same batch, if batch signing
+   * is enabled), and once all of them are signed and stored only the
+   * highest seqNo is announced, with a single sync update.
+   *
+   * @param contents  Blocks that will be set as the content of the packets
+   * @param freshness FreshnessPeriod of the data packets
+   */
+  void
+  publishBatch(const std::vector<Block>& contents, const ndn::time::milliseconds& freshness,
+               const Name& prefix = DEFAULT_PREFIX);
+
+  /**
+   * @brief Sign the published packets in batches
+   *
+   * The packets published within @p window of the first one (or until there
+   * are @p maxBatchSize of them) share a single signature over the root of a
+   * Merkle tree of their digests.  Each packet carries its Merkle proof and
+   * the signed root (see MerkleSignature).
+   *
+   * @param window       Time the first packet of a batch waits for others
+   * @param maxBatchSize Packets after which a batch is signed at once
+   */
+  void
+  enableBatchSigning(const ndn::time::milliseconds& window,
+                     size_t maxBatchSize = DEFAULT_MAX_BATCH_SIZE);
+
   /**
    * @brief Retrive a data packet with a particular seqNo from a session
    *
@@ -132,6 +167,29 @@ public:
             const ndn::OnTimeout& onTimeout,
             int nRetries = 0);
 
+  /**
+   * @brief Retrieve the data packets of a range of seqNos from a session
+   *
+   * Unlike calling fetchData() for each seqNo, the Interests are paced by a
+   * congestion window and each item has its own retry budget (see
+   * RangeFetcher).  It is meant for the low..high ranges of MissingDataInfo.
+   *
+   * @param sessionName  The name of the target session.
+   * @param low          The first seqNo.
+   * @param high         The last seqNo.
+   * @param onValidated  The callback for each retrieved and validated packet.
+   * @param onFailure    The callback for each seqNo that could not be retrieved.
+   * @param onCompletion The callback when all the seqNos are done, with the
+   *                     throughput of the fetch.
+   * @return the fetcher, which can be stopped
+   */
+  shared_ptr<RangeFetcher>
+  fetchRange(const Name& sessionName, const SeqNo& low, const SeqNo& high,
+             const ndn::OnDataValidated& onValidated,
+             const RangeFetcher::FailureCallback& onFailure,
+             const RangeFetcher::CompletionCallback& onCompletion,
+             const RangeFetcher::Options& options = RangeFetcher::Options());
+
   /// @brief Get the root digest of current sync tree
   ndn::ConstBufferPtr
   getRootDigest() const;
@@ -142,17 +200,46 @@ public:
     return m_logic;
   }
 
+  /**
+   * @brief Set the storage of the published packets
+   *
+   * The packets in the previous store are not moved to @p store, so it
+   * should be set before publishing.  By default the Socket uses a
+   * MemoryDataStore without limits; a DiskDataStore keeps the packets
+   * across restarts.
+   */
+  void
+  setDataStore(const shared_ptr<DataStore>& store);
+
+  DataStore&
+  getDataStore()
+  {
+    return *m_store;
+  }
+
 private:
+  // A packet waiting for its batch to be signed
+  struct BatchEntry
+  {
+    shared_ptr<Data> data;
+    Name prefix;
+    bool isAnnounced;
+  };
+
   void
   onInterest(const Name& prefix, const Interest& interest);
 
   void
   onData(const Interest& interest, Data& data,
+         const time::steady_clock::time_point& sentTime,
          const ndn::OnDataValidated& dataCallback,
          const ndn::OnDataValidationFailed& failCallback);
 
+  /**
+   * @param attempt transmissions of the Interest so far
+   */
   void
-  onDataTimeout(const Interest& interest, int nRetries,
+  onDataTimeout(const Interest& interest, int nRetries, unsigned attempt,
                 const ndn::OnDataValidated& dataCallback,
                 const ndn::OnDataValidationFailed& failCallback);
 
@@ -160,10 +247,39 @@ private:
   onDataValidationFailed(const shared_ptr<const Data>& data,
                          const std::string& failureInfo);
 
+  /**
+   * @brief Assign the next seqNo of the session of @p prefix to @p data
+   */
+  SeqNo
+  nameData(Data& data, const Name& prefix);
+
+  /**
+   * @brief Sign @p data, directly or in the next batch
+   */
+  void
+  signData(const shared_ptr<Data>& data, const Name& prefix, bool isAnnounced);
+
+  /**
+   * @param isAnnounced whether the seqNo of @p data is passed to the Logic;
+   *                    false for all but the last packet of a publishBatch()
+   */
+  void
+  onDataSigned(const shared_ptr<Data>& data, const Name& prefix, bool isAnnounced);
+
+  /// @brief Sign the packets collected in m_batch
+  void
+  signBatch();
+
+  void
+  onBatchSigned(const shared_ptr<Data>& rootData,
+                const std::vector<BatchEntry>& batch,
+                const shared_ptr<MerkleTree>& tree);
+
 public:
   static const ndn::Name DEFAULT_NAME;
   static const ndn::Name DEFAULT_PREFIX;
   static const ndn::shared_ptr<ndn::Validator> DEFAULT_VALIDATOR;
+  static const size_t DEFAULT_MAX_BATCH_SIZE;
 
 private:
   typedef std::unordered_map<ndn::Name, const ndn::RegisteredPrefixId*> RegisteredPrefixList;
@@ -173,11 +289,25 @@ private:
   Logic m_logic;
 
   ndn::Name m_signingId;
-  ndn::KeyChain& m_keyChain;
   ndn::shared_ptr<ndn::Validator> m_validator;
 
   RegisteredPrefixList m_registeredPrefixList;
-  ndn::util::InMemoryStoragePersistent m_ims;
+  shared_ptr<DataStore> m_store;
+
+  // Range fetches, stopped if still running when the Socket is destroyed
+  std::list<weak_ptr<RangeFetcher> > m_fetchers;
+
+  // Highest seqNo given to a Data still being signed, by session name
+  std::map<Name, SeqNo> m_pendingSeqNo;
+
+  // Batch signing
+  bool m_isBatchSigning;
+  ndn::time::milliseconds m_batchWindow;
+  size_t m_maxBatchSize;
+  // Packets waiting for the batch to be signed
+  std::vector<BatchEntry> m_batch;
+  ndn::Scheduler m_scheduler;
+  ndn::EventId m_batchId;
 };
 
 } // namespace chronosync
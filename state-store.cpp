@@ -0,0 +1,396 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "state-store.hpp"
+#include "file-io.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace chronosync {
+
+/**
+ * @brief Read-only memory mapping of a whole file
+ */
+class MappedFile : noncopyable
+{
+public:
+  explicit
+  MappedFile(const std::string& path)
+    : m_exists(false)
+    , m_data(0)
+    , m_size(0)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      if (errno == ENOENT)
+        return;
+      throw StateStore::Error(FileIo::errorString("Cannot open", path));
+    }
+    m_exists = true;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw StateStore::Error(FileIo::errorString("Cannot stat", path));
+    }
+
+    if (st.st_size > 0) {
+      void* data = ::mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        ::close(fd);
+        throw StateStore::Error(FileIo::errorString("Cannot map", path));
+      }
+      m_data = static_cast<const uint8_t*>(data);
+      m_size = st.st_size;
+    }
+
+    ::close(fd);
+  }
+
+  ~MappedFile()
+  {
+    if (m_data != 0)
+      ::munmap(const_cast<uint8_t*>(m_data), m_size);
+  }
+
+  bool
+  exists() const
+  {
+    return m_exists;
+  }
+
+  const uint8_t*
+  data() const
+  {
+    return m_data;
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+private:
+  bool m_exists;
+  const uint8_t* m_data;
+  size_t m_size;
+};
+
+template<bool T>
+static size_t
+prependState(ndn::EncodingImpl<T>& block, const State& state)
+{
+  size_t length = state.wireEncode(block);
+  length += block.prependVarNumber(length);
+  length += block.prependVarNumber(tlv::State);
+  return length;
+}
+
+template<bool T>
+static size_t
+encodeLogEntry(ndn::EncodingImpl<T>& block, const DiffState& diff)
+{
+  size_t totalLength = 0;
+
+  // encode cumulative info if it exists
+  CumulativeInfoPtr cumulativeInfo = diff.getCumulativeInfo();
+  if (cumulativeInfo) {
+    size_t length = 0;
+    length += cumulativeInfo->second.toComponent().wireEncode(block);
+    length += prependNonNegativeIntegerBlock(block, tlv::RoundNo, cumulativeInfo->first);
+    length += block.prependVarNumber(length);
+    length += block.prependVarNumber(tlv::CumulativeInfo);
+    totalLength += length;
+  }
+
+  totalLength += prependState(block, diff);
+  totalLength += prependNonNegativeIntegerBlock(block, tlv::RoundNo, diff.getRound());
+
+  totalLength += block.prependVarNumber(totalLength);
+  totalLength += block.prependVarNumber(tlv::LogEntry);
+
+  return totalLength;
+}
+
+template<bool T>
+static size_t
+encodeSnapshot(ndn::EncodingImpl<T>& block, const StateStore::SnapshotInfo& info,
+               const State& stableState, const State& state)
+{
+  size_t totalLength = 0;
+
+  totalLength += prependState(block, state);
+
+  size_t stableLength = prependState(block, stableState);
+  stableLength += block.prependVarNumber(stableLength);
+  stableLength += block.prependVarNumber(tlv::StableState);
+  totalLength += stableLength;
+
+  if (!info.stableCumulativeDigest.isZero())
+    totalLength += info.stableCumulativeDigest.toComponent().wireEncode(block);
+
+  totalLength += prependNonNegativeIntegerBlock(block, tlv::LastRecoveryRound,
+                                                info.lastRecoveryRound);
+  totalLength += prependNonNegativeIntegerBlock(block, tlv::StableRound, info.stableRound);
+  totalLength += prependNonNegativeIntegerBlock(block, tlv::CurrentRound, info.currentRound);
+  totalLength += prependNonNegativeIntegerBlock(block, tlv::SeqNo, info.seqNo);
+  totalLength += info.sessionName.wireEncode(block);
+
+  totalLength += block.prependVarNumber(totalLength);
+  totalLength += block.prependVarNumber(tlv::Snapshot);
+
+  return totalLength;
+}
+
+static DiffStatePtr
+decodeLogEntry(const Block& wire)
+{
+  if (wire.type() != tlv::LogEntry)
+    throw StateStore::Error("Unexpected TLV type when decoding LogEntry: " +
+                            boost::lexical_cast<std::string>(wire.type()));
+
+  wire.parse();
+  Block::element_const_iterator it = wire.elements_begin();
+
+  if (it == wire.elements_end() || it->type() != tlv::RoundNo)
+    throw StateStore::Error("No round when decoding LogEntry");
+  RoundNo round = readNonNegativeInteger(*it);
+  it++;
+
+  if (it == wire.elements_end() || it->type() != tlv::State)
+    throw StateStore::Error("No state when decoding LogEntry");
+  DiffStatePtr diff = make_shared<DiffState>();
+  diff->wireDecode(*it);
+  diff->setRound(round);
+  it++;
+
+  if (it != wire.elements_end() && it->type() == tlv::CumulativeInfo) {
+    it->parse();
+    Block::element_const_iterator val = it->elements_begin();
+    if (val == it->elements_end())
+      throw StateStore::Error("No round when decoding CumulativeInfo");
+    RoundNo cumulativeRound = readNonNegativeInteger(*val);
+    val++;
+
+    if (val == it->elements_end())
+      throw StateStore::Error("No digest when decoding CumulativeInfo");
+    Digest cumulativeDigest((name::Component(*val)));
+
+    diff->setCumulativeInfo(make_shared<CumulativeInfo>(std::make_pair(cumulativeRound,
+                                                                       cumulativeDigest)));
+  }
+
+  return diff;
+}
+
+
+StateStore::StateStore(const std::string& directory)
+  : m_directory(directory)
+  , m_logPath(directory + "/log")
+  , m_snapshotPath(directory + "/snapshot")
+  , m_logFd(-1)
+  , m_logSize(0)
+{
+  if (::mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+    throw Error(FileIo::errorString("Cannot create", directory));
+
+  openLog(false);
+}
+
+StateStore::~StateStore()
+{
+  if (m_logFd >= 0)
+    ::close(m_logFd);
+}
+
+void
+StateStore::openLog(bool truncate)
+{
+  if (m_logFd >= 0)
+    ::close(m_logFd);
+
+  int flags = O_WRONLY | O_CREAT | O_APPEND;
+  if (truncate)
+    flags |= O_TRUNC;
+
+  m_logFd = ::open(m_logPath.c_str(), flags, 0644);
+  if (m_logFd < 0)
+    throw Error(FileIo::errorString("Cannot open", m_logPath));
+
+  struct stat st;
+  if (::fstat(m_logFd, &st) != 0)
+    throw Error(FileIo::errorString("Cannot stat", m_logPath));
+  m_logSize = st.st_size;
+}
+
+bool
+StateStore::loadSnapshot(SnapshotInfo& info, State& stableState, State& state) const
+{
+  MappedFile file(m_snapshotPath);
+  if (!file.exists())
+    return false;
+
+  try {
+    Block wire;
+    if (!Block::fromBuffer(file.data(), file.size(), wire) || wire.type() != tlv::Snapshot)
+      throw Error("Corrupted snapshot " + m_snapshotPath);
+
+    wire.parse();
+    Block::element_const_iterator it = wire.elements_begin();
+    Block::element_const_iterator end = wire.elements_end();
+
+    if (it == end || it->type() != ndn::tlv::Name)
+      throw Error("No session name in snapshot");
+    info.sessionName.wireDecode(*it);
+    it++;
+
+    if (it == end || it->type() != tlv::SeqNo)
+      throw Error("No seqNo in snapshot");
+    info.seqNo = readNonNegativeInteger(*it);
+    it++;
+
+    if (it == end || it->type() != tlv::CurrentRound)
+      throw Error("No current round in snapshot");
+    info.currentRound = readNonNegativeInteger(*it);
+    it++;
+
+    if (it == end || it->type() != tlv::StableRound)
+      throw Error("No stable round in snapshot");
+    info.stableRound = readNonNegativeInteger(*it);
+    it++;
+
+    if (it == end || it->type() != tlv::LastRecoveryRound)
+      throw Error("No last recovery round in snapshot");
+    info.lastRecoveryRound = readNonNegativeInteger(*it);
+    it++;
+
+    info.stableCumulativeDigest = Digest();
+    if (it != end && it->type() == ndn::tlv::NameComponent) {
+      info.stableCumulativeDigest = Digest(name::Component(*it));
+      it++;
+    }
+
+    if (it == end || it->type() != tlv::StableState)
+      throw Error("No stable state in snapshot");
+    it->parse();
+    if (it->elements_begin() == it->elements_end())
+      throw Error("Empty stable state in snapshot");
+    stableState.reset();
+    stableState.wireDecode(*it->elements_begin());
+    it++;
+
+    if (it == end || it->type() != tlv::State)
+      throw Error("No state in snapshot");
+    state.reset();
+    state.wireDecode(*it);
+  }
+  catch (Error&) {
+    throw;
+  }
+  catch (std::runtime_error& e) {
+    throw Error("Corrupted snapshot " + m_snapshotPath + ": " + e.what());
+  }
+
+  return true;
+}
+
+std::vector<DiffStatePtr>
+StateStore::loadLog()
+{
+  std::vector<DiffStatePtr> entries;
+
+  MappedFile file(m_logPath);
+  size_t offset = 0;
+
+  while (offset < file.size()) {
+    Block wire;
+    if (!Block::fromBuffer(file.data() + offset, file.size() - offset, wire))
+      break;
+
+    try {
+      entries.push_back(decodeLogEntry(wire));
+    }
+    catch (std::runtime_error&) {
+      break;
+    }
+    offset += wire.size();
+  }
+
+  if (offset < file.size()) {
+    // Drop the torn entry, so new entries are appended after the last good one
+    if (::ftruncate(m_logFd, offset) != 0)
+      throw Error(FileIo::errorString("Cannot truncate", m_logPath));
+    m_logSize = offset;
+  }
+
+  return entries;
+}
+
+void
+StateStore::append(const DiffState& diff)
+{
+  ndn::EncodingEstimator estimator;
+  size_t estimatedSize = encodeLogEntry(estimator, diff);
+
+  ndn::EncodingBuffer buffer(estimatedSize, 0);
+  encodeLogEntry(buffer, diff);
+
+  Block wire = buffer.block();
+  try {
+    FileIo::writeAll(m_logFd, wire.wire(), wire.size(), m_logPath);
+  }
+  catch (FileIo::Error& e) {
+    throw Error(e.what());
+  }
+  m_logSize += wire.size();
+}
+
+void
+StateStore::writeSnapshot(const SnapshotInfo& info, const State& stableState, const State& state)
+{
+  ndn::EncodingEstimator estimator;
+  size_t estimatedSize = encodeSnapshot(estimator, info, stableState, state);
+
+  ndn::EncodingBuffer buffer(estimatedSize, 0);
+  encodeSnapshot(buffer, info, stableState, state);
+  Block wire = buffer.block();
+
+  // The snapshot must be on disk before the log is emptied
+  try {
+    FileIo::replaceFile(m_directory, m_snapshotPath, wire);
+  }
+  catch (FileIo::Error& e) {
+    throw Error(e.what());
+  }
+
+  // If we stop before truncating, the log entries are replayed on top of the
+  // new snapshot, which is harmless: merging leaves keeps the largest seqNo
+  openLog(true);
+}
+
+} // namespace chronosync
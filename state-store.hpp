@@ -0,0 +1,156 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_STATE_STORE_HPP
+#define CHRONOSYNC_STATE_STORE_HPP
+
+#include "diff-state.hpp"
+
+namespace chronosync {
+
+/**
+ * @brief On-disk persistence of the state of a Logic
+ *
+ * A store is a directory with two files:
+ *
+ * - "log": append-only write-ahead log of round log entries (LogEntry TLV
+ *   blocks, one per Logic::updateDiffLog()).  A torn entry at the end of the
+ *   file (e.g., after a crash) is ignored and truncated.
+ * - "snapshot": a Snapshot TLV block with the session, the round counters,
+ *   the stable state and the current state.  It is replaced atomically
+ *   (written to a temporary file and renamed), and the log is truncated.
+ *
+ * Both files are TLV and are read through mmap(2).  A new snapshot is synced
+ * to the disk, with the directory, before the log is truncated, so a crash
+ * of the host can't lose both.  Log appends are not synced: they survive a
+ * crash of the process, but a crash of the host may lose the entries
+ * appended since the last snapshot.
+ */
+class StateStore : noncopyable
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  /**
+   * @brief Session and round counters stored in a snapshot
+   */
+  struct SnapshotInfo
+  {
+    SnapshotInfo()
+      : seqNo(0)
+      , currentRound(1)
+      , stableRound(0)
+      , lastRecoveryRound(0)
+    {
+    }
+
+    Name sessionName;
+    SeqNo seqNo;
+    RoundNo currentRound;
+    RoundNo stableRound;
+    RoundNo lastRecoveryRound;
+    /// cumulative digest of stableRound, zero if there is no stable round
+    Digest stableCumulativeDigest;
+  };
+
+  /**
+   * @brief Open (creating it if needed) the store in @p directory
+   *
+   * @throws Error if the directory or the log can't be created or opened
+   */
+  explicit
+  StateStore(const std::string& directory);
+
+  ~StateStore();
+
+  /**
+   * @brief Read the snapshot
+   *
+   * @param info        receives the session and round counters
+   * @param stableState receives the stable state (Logic::m_oldState)
+   * @param state       receives the current state (Logic::m_state)
+   * @return false if the store has no snapshot
+   * @throws Error if the snapshot is corrupted
+   */
+  bool
+  loadSnapshot(SnapshotInfo& info, State& stableState, State& state) const;
+
+  /**
+   * @brief Read the entries appended to the log since the last snapshot
+   *
+   * Each entry is a DiffState with its round, leaves and cumulative info.
+   * A torn entry at the end of the log is removed from the file.
+   */
+  std::vector<DiffStatePtr>
+  loadLog();
+
+  /**
+   * @brief Append the round, leaves and cumulative info of @p diff to the log
+   *
+   * The entry is not synced to the disk.
+   *
+   * @throws Error if the entry can't be written
+   */
+  void
+  append(const DiffState& diff);
+
+  /**
+   * @brief Replace the snapshot and truncate the log
+   *
+   * @throws Error if the snapshot can't be written
+   */
+  void
+  writeSnapshot(const SnapshotInfo& info, const State& stableState, const State& state);
+
+  /**
+   * @brief Size of the log in bytes
+   */
+  size_t
+  getLogSize() const
+  {
+    return m_logSize;
+  }
+
+private:
+  void
+  openLog(bool truncate);
+
+private:
+  std::string m_directory;
+  std::string m_logPath;
+  std::string m_snapshotPath;
+
+  int m_logFd;
+  size_t m_logSize;
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_STATE_STORE_HPP
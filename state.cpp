@@ -26,10 +26,16 @@
 
 #include "state.hpp"
 
+#include <ndn-cxx/security/cryptopp.hpp>
+
 namespace chronosync {
 
 using boost::make_tuple;
 
+State::State()
+  : m_isDigestCached(false)
+{
+}
 
 State::~State()
 {
@@ -37,7 +43,7 @@ State::~State()
 
 
 SeqNo
-State::getSeqNo(const Name& info) {
+State::getSeqNo(const SessionKey& info) {
   LeafContainer::iterator leaf = m_leaves.find(info);
 
   if (leaf == m_leaves.end()) {
@@ -52,20 +58,24 @@ State::getSeqNo(const Name& info) {
 /**
  * @brief Add or update leaf to the sync tree
  *
- * @param info session name of the leaf
+ * @param info session name (or session name with its hash) of the leaf
  * @param seq  sequence number of the leaf
  * @return 3-tuple (isInserted, isUpdated, oldSeqNo)
  */
 
 boost::tuple<bool, bool, SeqNo>
-State::update(const Name& info, const SeqNo& seq)
+State::update(const SessionKey& info, const SeqNo& seq)
 {
   m_wire.reset();
 
   LeafContainer::iterator leaf = m_leaves.find(info);
 
   if (leaf == m_leaves.end()) {
-    m_leaves.insert(make_shared<Leaf>(info, cref(seq)));
+    m_isDigestCached = false;
+    leaf = m_leaves.addLeaf(info, seq);
+#ifndef CHRONOSYNC_ORDERED_ROOT_DIGEST
+    m_digestSum += (*leaf)->getDigest();
+#endif
     return make_tuple(true, false, 0);
   }
   else {
@@ -74,24 +84,40 @@ State::update(const Name& info, const SeqNo& seq)
     }
 
     SeqNo old = (*leaf)->getSeq();
-    m_leaves.modify(leaf,
-                    [=] (LeafPtr& leaf) { leaf->setSeq(seq); } );
+    m_isDigestCached = false;
+#ifndef CHRONOSYNC_ORDERED_ROOT_DIGEST
+    m_digestSum -= (*leaf)->getDigest();
+#endif
+    m_leaves.setLeafSeq(leaf, seq);
+#ifndef CHRONOSYNC_ORDERED_ROOT_DIGEST
+    m_digestSum += (*leaf)->getDigest();
+#endif
     return make_tuple(false, true, old);
   }
 }
 
-ndn::ConstBufferPtr
+Digest
 State::getDigest() const
 {
+  if (m_isDigestCached)
+    return m_digest;
 
-  m_digest.reset();
-  BOOST_FOREACH (ConstLeafPtr leaf, m_leaves.get<ordered>())
+#ifdef CHRONOSYNC_ORDERED_ROOT_DIGEST
+  CryptoPP::SHA256 hash;
+  BOOST_FOREACH (ConstLeafRef leaf, m_leaves.get<ordered>())
     {
-      BOOST_ASSERT(leaf != 0);
-      m_digest.update(leaf->getDigest()->buf(), leaf->getDigest()->size());
+      hash.Update(leaf->getDigest().data(), leaf->getDigest().size());
     }
-
-  return m_digest.computeDigest();
+  hash.Final(m_digest.data());
+#else
+  if (m_leaves.empty())
+    m_digest = EMPTY_DIGEST;
+  else
+    m_digest = Digest::sha256(m_digestSum.data(), m_digestSum.size());
+#endif
+
+  m_isDigestCached = true;
+  return m_digest;
 }
 
 
@@ -100,15 +126,17 @@ void
 State::reset()
 {
   m_leaves.clear();
+  m_digestSum = Digest();
+  m_isDigestCached = false;
+  m_wire.reset();
 }
 
 State&
 State::operator+=(const State& state)
 {
-  BOOST_FOREACH (ConstLeafPtr leaf, state.getLeaves())
+  BOOST_FOREACH (ConstLeafRef leaf, state.getLeaves())
     {
-      BOOST_ASSERT(leaf != 0);
-      update(leaf->getSessionName(), leaf->getSeq());
+      update(leaf->getSessionKey(), leaf->getSeq());
     }
 
   return *this;
@@ -120,7 +148,7 @@ State::wireEncode(ndn::EncodingImpl<T>& block) const
 {
   size_t totalLength = 0;
 
-  BOOST_REVERSE_FOREACH (ConstLeafPtr leaf, m_leaves.get<ordered>())
+  BOOST_REVERSE_FOREACH (ConstLeafRef leaf, m_leaves.get<ordered>())
     {
       size_t entryLength = 0;
       entryLength += prependNonNegativeIntegerBlock(block, tlv::SeqNo, leaf->getSeq());
@@ -179,7 +207,7 @@ State::wireDecode(const Block& wire)
       val++;
 
       if (val != it->elements_end())
-        update(info, readNonNegativeInteger(*val));
+        update(SessionKey(info), readNonNegativeInteger(*val));
       else
         throw Error("No seqNo when decoding SyncReply");
     }
@@ -29,7 +29,6 @@
 
 #include "tlv.hpp"
 #include "leaf-container.hpp"
-#include <ndn-cxx/util/digest.hpp>
 
 namespace chronosync {
 
@@ -58,23 +57,30 @@ public:
   };
 
 
+  State();
+
   virtual
   ~State();
 
 
 
+  /**
+   * @brief Get the sequence number of a session, 0 if the session is unknown
+   *
+   * @param info session name (or session name with its hash) of the leaf
+   */
   SeqNo
-  getSeqNo(const Name& info);
+  getSeqNo(const SessionKey& info);
 
   /**
    * @brief Add or update leaf to the sync tree
    *
-   * @param info session name of the leaf
+   * @param info session name (or session name with its hash) of the leaf
    * @param seq  sequence number of the leaf
    * @return 3-tuple (isInserted, isUpdated, oldSeqNo)
    */
   boost::tuple<bool, bool, SeqNo>
-  update(const Name& info, const SeqNo& seq);
+  update(const SessionKey& info, const SeqNo& seq);
 
   /**
    * @brief Get state leaves
@@ -85,7 +91,21 @@ public:
     return m_leaves;
   }
 
-  ndn::ConstBufferPtr
+  /**
+   * @brief Get the root digest of the state
+   *
+   * By default the root digest is maintained incrementally: every leaf digest
+   * is added (mod 2^256) to an accumulator in update(), so a leaf change costs
+   * O(1) and this method only hashes the 32-byte accumulator.  The digest of an
+   * empty state is the SHA-256 of the empty string in both modes.
+   *
+   * Define CHRONOSYNC_ORDERED_ROOT_DIGEST to get the original digest, computed
+   * over the concatenation of all leaf digests in session name order.  All the
+   * nodes of a sync group must use the same mode.
+   *
+   * The result is cached until the next change of the leaves.
+   */
+  Digest
   getDigest() const;
 
   /**
@@ -125,7 +145,13 @@ public:
 protected:
   LeafContainer m_leaves;
 
-  mutable ndn::util::Sha256 m_digest;
+  // Sum (mod 2^256, big-endian) of the digests of all leaves
+  Digest m_digestSum;
+
+  // Root digest computed by getDigest(), valid if m_isDigestCached
+  mutable Digest m_digest;
+  mutable bool m_isDigestCached;
+
   mutable Block m_wire;
 };
 
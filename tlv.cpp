@@ -39,6 +39,24 @@ operator<<(std::ostream &o, const DataType t) {
     case State: return o << "State";   
     case CumulativeInfo: return o << "CumulativeInfo";   
     case RecoveryData: return o << "RecoveryData";   
+    case LogEntry: return o << "LogEntry";
+    case Snapshot: return o << "Snapshot";
+    case CurrentRound: return o << "CurrentRound";
+    case StableRound: return o << "StableRound";
+    case LastRecoveryRound: return o << "LastRecoveryRound";
+    case StableState: return o << "StableState";
+    case BaseRoundNo: return o << "BaseRoundNo";
+    case Iblt: return o << "Iblt";
+    case MultiRoundContent: return o << "MultiRoundContent";
+    case MerkleLeafIndex: return o << "MerkleLeafIndex";
+    case MerkleProofHash: return o << "MerkleProofHash";
+    case StoreIndex: return o << "StoreIndex";
+    case SegmentNo: return o << "SegmentNo";
+    case SegmentOffset: return o << "SegmentOffset";
+    case IndexSession: return o << "IndexSession";
+    case IndexLocations: return o << "IndexLocations";
+    case NextRoundNo: return o << "NextRoundNo";
+    case RecoTransferId: return o << "RecoTransferId";
     default: return o<<"(invalid value)"; 
   }
 }
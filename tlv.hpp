@@ -43,7 +43,25 @@ enum DataType {
   RoundNo            = 133, // 0x85
   State              = 134, // 0x86
   CumulativeInfo     = 135, // 0x87
-  RecoveryData       = 136  // 0x88
+  RecoveryData       = 136, // 0x88
+  LogEntry           = 137, // 0x89
+  Snapshot           = 138, // 0x8a
+  CurrentRound       = 139, // 0x8b
+  StableRound        = 140, // 0x8c
+  LastRecoveryRound  = 141, // 0x8d
+  StableState        = 142, // 0x8e
+  BaseRoundNo        = 143, // 0x8f
+  Iblt               = 144, // 0x90
+  MultiRoundContent  = 145, // 0x91
+  MerkleLeafIndex    = 146, // 0x92
+  MerkleProofHash    = 147, // 0x93
+  StoreIndex         = 148, // 0x94
+  SegmentNo          = 149, // 0x95
+  SegmentOffset      = 150, // 0x96
+  IndexSession       = 151, // 0x97
+  IndexLocations     = 152, // 0x98
+  NextRoundNo        = 153, // 0x99
+  RecoTransferId     = 154  // 0x9a
 };
 
 std::ostream & operator<<(std::ostream &o, const DataType t);
@@ -0,0 +1,61 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#include "validation-cache.hpp"
+
+namespace chronosync {
+
+// Validated full names remembered by default
+const size_t ValidationCache::DEFAULT_CAPACITY(4096);
+
+ValidationCache::ValidationCache(size_t capacity)
+  : m_capacity(capacity)
+{
+}
+
+bool
+ValidationCache::contains(const Name& fullName)
+{
+  std::unordered_map<Name, NameList::iterator>::iterator it = m_index.find(fullName);
+  if (it == m_index.end())
+    return false;
+
+  m_names.splice(m_names.begin(), m_names, it->second);
+  return true;
+}
+
+void
+ValidationCache::insert(const Name& fullName)
+{
+  if (m_capacity == 0 || contains(fullName))
+    return;
+
+  m_names.push_front(fullName);
+  m_index[fullName] = m_names.begin();
+
+  if (m_names.size() > m_capacity) {
+    m_index.erase(m_names.back());
+    m_names.pop_back();
+  }
+}
+
+} // namespace chronosync
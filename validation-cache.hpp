@@ -0,0 +1,76 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012-2014 University of California, Los Angeles
+ *
+ * This file is part of ChronoSync, synchronization library for distributed realtime
+ * applications for NDN.
+ *
+ * ChronoSync is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * ChronoSync is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * ChronoSync, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @author Pedro de las Heras Quiros <pedro.delasheras@urjc.es>
+ * @author Eva M. Castro <eva.castro@urjc.es>
+ */
+
+#ifndef CHRONOSYNC_VALIDATION_CACHE_HPP
+#define CHRONOSYNC_VALIDATION_CACHE_HPP
+
+#include "common-chronosync.hpp"
+
+#include <unordered_map>
+
+namespace chronosync {
+
+/**
+ * @brief LRU set of the full names (including the implicit digest) of
+ *        validated Data
+ *
+ * A Data whose full name is in the cache is the same packet that was
+ * validated before, so it doesn't need to be validated again.
+ */
+class ValidationCache : noncopyable
+{
+public:
+  static const size_t DEFAULT_CAPACITY;
+
+  explicit
+  ValidationCache(size_t capacity = DEFAULT_CAPACITY);
+
+  /**
+   * @brief Whether @p fullName is cached, making it the most recently used
+   */
+  bool
+  contains(const Name& fullName);
+
+  /**
+   * @brief Add @p fullName, evicting the least recently used name if full
+   */
+  void
+  insert(const Name& fullName);
+
+  size_t
+  size() const
+  {
+    return m_names.size();
+  }
+
+private:
+  typedef std::list<Name> NameList;
+
+  size_t m_capacity;
+  // Most recently used first
+  NameList m_names;
+  std::unordered_map<Name, NameList::iterator> m_index;
+};
+
+} // namespace chronosync
+
+#endif // CHRONOSYNC_VALIDATION_CACHE_HPP